@@ -33,6 +33,7 @@ import java.nio.file.Files;
 import java.nio.file.Paths;
 
 import vendor.samsung.hardware.spen.ISPen;
+import vendor.samsung.hardware.spen.SPenState;
 
 public class SPenConnectionManager extends BroadcastReceiver {
 
@@ -53,7 +54,8 @@ public class SPenConnectionManager extends BroadcastReceiver {
     }
 
     public void connect() throws RemoteException {
-        String blespenAddr = mSPenHAL.getMACAddress();
+        SPenState state = mSPenHAL.getState();
+        String blespenAddr = state.macAddress;
         Log.i(LOG_TAG, "Connecting! SPen BLE address: " + blespenAddr);
 
         mCurBleSpenAddr = blespenAddr;
@@ -72,7 +74,7 @@ public class SPenConnectionManager extends BroadcastReceiver {
 
         mSpen = mAdapter.getRemoteDevice(blespenAddr);
 
-        if (!mSPenHAL.isCharging())
+        if (!state.charging)
             mSPenHAL.setCharging(true);
 
         if (mGatt == null || bluetoothManager.getConnectionState(mSpen, BluetoothProfile.GATT_SERVER)
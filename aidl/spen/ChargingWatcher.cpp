@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "vendor.samsung.hardware.spen-service.davinci"
+
+#include "ChargingWatcher.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <android-base/logging.h>
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+/* Re-read interval used as long as the driver hasn't notified us. */
+static constexpr int kFallbackIntervalMs = 1000;
+
+ChargingWatcher::ChargingWatcher(const std::string& path, Listener listener)
+    : mNode(path),
+      mListener(std::move(listener)),
+      mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      mEnabled(false),
+      mStop(false) {
+    if (!mEventFd.ok()) {
+        PLOG(FATAL) << "Failed to create eventfd";
+    }
+
+    mThread = std::thread(&ChargingWatcher::run, this);
+}
+
+ChargingWatcher::~ChargingWatcher() {
+    mStop = true;
+    wake();
+    mThread.join();
+}
+
+void ChargingWatcher::setEnabled(bool enabled) {
+    if (mEnabled.exchange(enabled) != enabled) {
+        wake();
+    }
+}
+
+void ChargingWatcher::refresh() {
+    wake();
+}
+
+void ChargingWatcher::wake() {
+    uint64_t one = 1;
+
+    if (TEMP_FAILURE_RETRY(write(mEventFd.get(), &one, sizeof(one))) != sizeof(one)) {
+        PLOG(ERROR) << "Failed to wake charging watcher";
+    }
+}
+
+void ChargingWatcher::run() {
+    bool notifySeen = false;
+    bool readFailed = false;
+    int readFd = -1;
+    std::string last;
+
+    auto readNode = [&]() {
+        std::string mode;
+
+        /* Reading the node also re-arms sysfs_notify() for this fd. */
+        readFailed = !mNode.read(&mode);
+        if (!readFailed && mode != last) {
+            mListener(mode);
+            last = std::move(mode);
+        }
+    };
+
+    while (!mStop) {
+        bool enabled = mEnabled;
+        /* Back off from a node that fails to read, it may keep raising POLLERR. */
+        int nodeFd = enabled && !readFailed ? mNode.fd() : -1;
+
+        /*
+         * kernfs raises POLLPRI|POLLERR on an attribute that was never read
+         * through the fd, so read it once before polling it, or that would
+         * be taken for a notification.
+         */
+        if (nodeFd >= 0 && nodeFd != readFd) {
+            readNode();
+            if (readFailed) {
+                continue;
+            }
+            readFd = nodeFd;
+        }
+
+        struct pollfd fds[] = {
+            { .fd = mEventFd.get(), .events = POLLIN, .revents = 0 },
+            { .fd = nodeFd, .events = POLLPRI | POLLERR, .revents = 0 },
+        };
+        int timeout = enabled && (!notifySeen || nodeFd < 0) ? kFallbackIntervalMs : -1;
+
+        if (poll(fds, nodeFd < 0 ? 1 : 2, timeout) < 0) {
+            if (errno != EINTR) {
+                PLOG(ERROR) << "Failed to poll " << mNode.path();
+            }
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            (void)TEMP_FAILURE_RETRY(read(mEventFd.get(), &count, sizeof(count)));
+        }
+
+        if (!mEnabled) {
+            last.clear();
+            continue;
+        }
+
+        if (nodeFd >= 0 && (fds[1].revents & (POLLPRI | POLLERR))) {
+            notifySeen = true;
+        }
+
+        readNode();
+    }
+}
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
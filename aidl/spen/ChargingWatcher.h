@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <android-base/unique_fd.h>
+
+#include "SysfsNode.h"
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+/*
+ * Watches the charging mode node from a single thread and reports the raw
+ * mode whenever it differs from the previous read.
+ *
+ * The node is poll()ed for POLLPRI/POLLERR, which the driver raises through
+ * sysfs_notify(). Until such an event has been seen the node is re-read on
+ * a timer instead, as not every kernel notifies. While disabled the thread
+ * sleeps without any wakeups.
+ */
+class ChargingWatcher {
+public:
+    using Listener = std::function<void(const std::string& mode)>;
+
+    ChargingWatcher(const std::string& path, Listener listener);
+    ~ChargingWatcher();
+
+    void setEnabled(bool enabled);
+
+    /*
+     * Re-read the node now, e.g. after it has been written to.
+     */
+    void refresh();
+
+private:
+    void wake();
+    void run();
+
+    SysfsNode mNode;
+    Listener mListener;
+    ::android::base::unique_fd mEventFd;
+    std::atomic<bool> mEnabled;
+    std::atomic<bool> mStop;
+    std::thread mThread;
+};
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
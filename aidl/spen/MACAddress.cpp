@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "MACAddress.h"
+
+#include <ctype.h>
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool packMACAddress(const std::string& mac, uint64_t *packed) {
+    uint64_t value = kMACAddressCached;
+
+    if (mac.size() != 17) {
+        return false;
+    }
+
+    for (size_t i = 0; i < mac.size(); i += 3) {
+        int hi = hexValue(mac[i]);
+        int lo = hexValue(mac[i + 1]);
+
+        if (hi < 0 || lo < 0 || (i + 2 < mac.size() && mac[i + 2] != ':')) {
+            return false;
+        }
+
+        // Digit i / 3 * 2 of 12, counted from the left.
+        int digit = i / 3 * 2;
+        if (islower(mac[i])) {
+            value |= 1ULL << (kMACAddressCaseShift + 11 - digit);
+        }
+        if (islower(mac[i + 1])) {
+            value |= 1ULL << (kMACAddressCaseShift + 10 - digit);
+        }
+
+        value = (value & ~0xffffffffffffULL) | ((value << 8 | hi << 4 | lo) & 0xffffffffffffULL);
+    }
+
+    *packed = value;
+    return true;
+}
+
+std::string unpackMACAddress(uint64_t packed) {
+    static constexpr char kUpper[] = "0123456789ABCDEF";
+    static constexpr char kLower[] = "0123456789abcdef";
+    std::string mac(17, ':');
+
+    for (int digit = 0; digit < 12; digit++) {
+        int value = packed >> (44 - 4 * digit) & 0xf;
+        bool lower = packed >> (kMACAddressCaseShift + 11 - digit) & 1;
+
+        mac[digit / 2 * 3 + digit % 2] = lower ? kLower[value] : kUpper[value];
+    }
+
+    return mac;
+}
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+/*
+ * A cached MAC address is packed into the low 48 bits, so it can be
+ * published through a single atomic. Zero means nothing is cached.
+ *
+ * Which of the 12 hex digits were lowercase is kept in the 12 bits above,
+ * the first digit highest, so the address comes back exactly as written.
+ */
+static constexpr uint64_t kMACAddressCached = 1ULL << 63;
+static constexpr int kMACAddressCaseShift = 48;
+
+/*
+ * Pack an address formatted as "xx:xx:xx:xx:xx:xx". Returns false, leaving
+ * packed alone, if it isn't one.
+ */
+bool packMACAddress(const std::string& mac, uint64_t *packed);
+std::string unpackMACAddress(uint64_t packed);
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
@@ -6,65 +6,323 @@
 
 #define LOG_TAG "vendor.samsung.hardware.spen-service.davinci"
 
-#include <fstream>
-
 #include "SPen.h"
 
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+
+#include "MACAddress.h"
+
 namespace aidl {
 namespace vendor {
 namespace samsung {
 namespace hardware {
 namespace spen {
 
+static constexpr const char *kChargingModePath = "/sys/class/sec/sec_epen/epen_ble_charging_mode";
+static constexpr const char *kMACAddressPath = "/mnt/vendor/efs/spen/blespen_addr";
+static constexpr const char *kLegacyMACAddressPath = "/efs/spen/blespen_addr";
+static constexpr const char *kDefaultMACAddress = "00:00:00:00:00:00";
+static constexpr const char *kChargingMode = "CHARGE";
+
 /*
- * Write value to path and close file.
+ * Read the first token of path.
  */
-template <typename T>
-static void set(const std::string& path, const T& value) {
-    std::ofstream file(path);
-    file << value << std::endl;
+static bool get(const std::string& path, std::string *value) {
+    std::string content;
+
+    if (!::android::base::ReadFileToString(path, &content)) {
+        return false;
+    }
+
+    content = ::android::base::Trim(content);
+    if (content.empty()) {
+        return false;
+    }
+
+    *value = content.substr(0, content.find_first_of(" \t\n"));
+    return true;
 }
 
-template <typename T>
-static T get(const std::string& path, const T& def) {
-    std::ifstream file(path);
-    T result;
+/*
+ * Replace path through a synced temporary file, so it is never seen half written.
+ */
+static bool setAtomic(const std::string& path, const std::string& value) {
+    std::string tmpPath = path + ".XXXXXX";
+    ::android::base::unique_fd fd(mkostemp(tmpPath.data(), O_CLOEXEC));
+
+    if (!fd.ok()) {
+        PLOG(ERROR) << "Failed to create a temporary file for " << path;
+        return false;
+    }
+
+    if (fchmod(fd.get(), 0660) != 0 ||
+            !::android::base::WriteFully(fd.get(), value.data(), value.size()) ||
+            fsync(fd.get()) != 0) {
+        PLOG(ERROR) << "Failed to write " << tmpPath;
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    fd.reset();
+
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        PLOG(ERROR) << "Failed to rename " << tmpPath << " to " << path;
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    /* Make the rename itself durable. */
+    ::android::base::unique_fd dir(TEMP_FAILURE_RETRY(
+            open(::android::base::Dirname(path).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+    if (dir.ok()) {
+        fsync(dir.get());
+    }
 
-    file >> result;
-    return file.fail() ? def : result;
+    return true;
 }
 
-SPen::SPen() {}
+SPen::SPen(const std::string& root)
+    : mChargingMode(root + kChargingModePath),
+      mEfsMACAddressPath(root + kMACAddressPath),
+      mLegacyEfsMACAddressPath(root + kLegacyMACAddressPath),
+      mMACAddressPath(nullptr),
+      mMACAddress(0),
+      mDeathRecipient(AIBinder_DeathRecipient_new(onCallbackDied)),
+      mChargingWatcher(root + kChargingModePath,
+                       [this](const std::string& mode) { onChargingModeRead(mode); }) {}
 
 ndk::ScopedAStatus SPen::setCharging(bool in_charging, bool *_aidl_return) {
-    set("/sys/class/sec/sec_epen/epen_ble_charging_mode", in_charging ? 1 : 0);
+    mChargingMode.write(in_charging ? "1\n" : "0\n");
+    mChargingWatcher.refresh();
 
     return isCharging(_aidl_return);
 }
 
 ndk::ScopedAStatus SPen::isCharging(bool *_aidl_return) {
-    *_aidl_return = get("/sys/class/sec/sec_epen/epen_ble_charging_mode", std::string("NG")) == "CHARGE";
+    std::string mode;
+
+    *_aidl_return = readChargingMode(&mode) && mode == kChargingMode;
 
     return ndk::ScopedAStatus::ok();
 }
 
+bool SPen::readChargingMode(std::string *mode) {
+    if (!mChargingMode.read(mode)) {
+        return false;
+    }
+
+    onChargingModeRead(*mode);
+    return true;
+}
+
+/*
+ * Record a freshly read charging mode and notify callbacks if the pen
+ * started or stopped charging since the last read.
+ */
+void SPen::onChargingModeRead(const std::string& mode) {
+    if (mode == mChargingModeCache.load().mode) {
+        return;
+    }
+
+    /*
+     * Another thread may have read the node before this one and still be
+     * about to record what it read. Changes are rare, so the node is read
+     * again under the lock and only that is recorded, which keeps the cache
+     * and the callbacks in the order the node changed.
+     */
+    std::lock_guard<std::mutex> lock(mChargingModeLock);
+    std::string current;
+
+    if (!mChargingMode.read(&current)) {
+        current = mode;
+    }
+
+    ChargingModeSnapshot snapshot = mChargingModeCache.load();
+    if (current == snapshot.mode) {
+        return;
+    }
+
+    bool wasCharging = strcmp(snapshot.mode, kChargingMode) == 0;
+    struct timespec now;
+
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    snprintf(snapshot.mode, sizeof(snapshot.mode), "%s", current.c_str());
+    snapshot.updatedNs = now.tv_sec * 1000000000LL + now.tv_nsec;
+    mChargingModeCache.store(snapshot);
+
+    /* The callbacks are oneway, so notifying under the lock doesn't block on clients. */
+    bool charging = current == kChargingMode;
+    if (charging != wasCharging) {
+        onChargingChanged(charging);
+    }
+}
+
+/*
+ * Pick the EFS copy of the MAC address once, preferring the vendor one.
+ * Stays unresolved while neither exists, e.g. before EFS is mounted.
+ */
+const char *SPen::macAddressPath() {
+    const char *path = mMACAddressPath.load(std::memory_order_acquire);
+
+    if (path == nullptr) {
+        if (access(mEfsMACAddressPath.c_str(), F_OK) == 0) {
+            path = mEfsMACAddressPath.c_str();
+        } else if (access(mLegacyEfsMACAddressPath.c_str(), F_OK) == 0) {
+            path = mLegacyEfsMACAddressPath.c_str();
+        } else {
+            return nullptr;
+        }
+
+        mMACAddressPath.store(path, std::memory_order_release);
+    }
+
+    return path;
+}
+
 ndk::ScopedAStatus SPen::getMACAddress(std::string *_aidl_return) {
-    std::ifstream file("/mnt/vendor/efs/spen/blespen_addr");
-    if (file.good()) {
-        *_aidl_return = get("/mnt/vendor/efs/spen/blespen_addr", std::string("00:00:00:00:00:00"));
-    } else {
-        *_aidl_return = get("/efs/spen/blespen_addr", std::string("00:00:00:00:00:00"));
+    uint64_t packed = mMACAddress.load(std::memory_order_acquire);
+
+    if (packed & kMACAddressCached) {
+        *_aidl_return = unpackMACAddress(packed);
+        return ndk::ScopedAStatus::ok();
+    }
+
+    const char *path = macAddressPath();
+    if (path == nullptr || !get(path, _aidl_return)) {
+        *_aidl_return = kDefaultMACAddress;
+        return ndk::ScopedAStatus::ok();
+    }
+
+    /*
+     * Only fill an empty cache, a concurrent setMACAddress() may already
+     * have published a newer address than the one just read.
+     */
+    if (packMACAddress(*_aidl_return, &packed)) {
+        uint64_t expected = 0;
+        mMACAddress.compare_exchange_strong(expected, packed, std::memory_order_acq_rel);
     }
 
     return ndk::ScopedAStatus::ok();
 }
 
 ndk::ScopedAStatus SPen::setMACAddress(const std::string& in_mac) {
-    set("/mnt/vendor/efs/spen/blespen_addr", in_mac);
+    uint64_t packed = 0;
+
+    if (setAtomic(mEfsMACAddressPath, in_mac + "\n")) {
+        mMACAddressPath.store(mEfsMACAddressPath.c_str(), std::memory_order_release);
+        packMACAddress(in_mac, &packed);
+    } else {
+        mMACAddressPath.store(nullptr, std::memory_order_release);
+    }
+
+    mMACAddress.store(packed, std::memory_order_release);
+
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus SPen::registerCallback(const std::shared_ptr<ISPenCallback>& in_callback) {
+    if (in_callback == nullptr) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mCallbacksLock);
+
+        for (const auto& callback : mCallbacks) {
+            if (callback->asBinder() == in_callback->asBinder()) {
+                return ndk::ScopedAStatus::ok();
+            }
+        }
+
+        AIBinder_linkToDeath(in_callback->asBinder().get(), mDeathRecipient.get(), this);
+        mCallbacks.push_back(in_callback);
+        mChargingWatcher.setEnabled(true);
+    }
+
+    bool charging;
+    isCharging(&charging);
+    in_callback->onChargingChanged(charging);
+
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus SPen::unregisterCallback(const std::shared_ptr<ISPenCallback>& in_callback) {
+    if (in_callback == nullptr) {
+        return ndk::ScopedAStatus::fromExceptionCode(EX_ILLEGAL_ARGUMENT);
+    }
+
+    std::lock_guard<std::mutex> lock(mCallbacksLock);
+
+    auto it = std::find_if(mCallbacks.begin(), mCallbacks.end(), [&](const auto& callback) {
+        return callback->asBinder() == in_callback->asBinder();
+    });
+    if (it != mCallbacks.end()) {
+        AIBinder_unlinkToDeath(in_callback->asBinder().get(), mDeathRecipient.get(), this);
+        mCallbacks.erase(it);
+    }
+
+    mChargingWatcher.setEnabled(!mCallbacks.empty());
 
     return ndk::ScopedAStatus::ok();
 }
 
+/*
+ * The node is read once to refresh the cache, everything else is served
+ * from memory. If the read fails, the last known mode is reported.
+ */
+ndk::ScopedAStatus SPen::getState(SPenState *_aidl_return) {
+    std::string mode;
+
+    readChargingMode(&mode);
+
+    ChargingModeSnapshot snapshot = mChargingModeCache.load();
+    _aidl_return->chargingMode = snapshot.mode;
+    _aidl_return->charging = _aidl_return->chargingMode == kChargingMode;
+    _aidl_return->lastUpdateNs = snapshot.updatedNs;
+
+    return getMACAddress(&_aidl_return->macAddress);
+}
+
+void SPen::onChargingChanged(bool charging) {
+    std::vector<std::shared_ptr<ISPenCallback>> callbacks;
+
+    {
+        std::lock_guard<std::mutex> lock(mCallbacksLock);
+        callbacks = mCallbacks;
+    }
+
+    for (const auto& callback : callbacks) {
+        callback->onChargingChanged(charging);
+    }
+}
+
+/*
+ * The cookie doesn't tell which client died, so drop every dead one.
+ */
+void SPen::onCallbackDied(void *cookie) {
+    SPen *self = static_cast<SPen *>(cookie);
+    std::lock_guard<std::mutex> lock(self->mCallbacksLock);
+
+    self->mCallbacks.erase(std::remove_if(self->mCallbacks.begin(), self->mCallbacks.end(),
+            [](const auto& callback) {
+                return !AIBinder_isAlive(callback->asBinder().get());
+            }), self->mCallbacks.end());
+
+    self->mChargingWatcher.setEnabled(!self->mCallbacks.empty());
+}
+
 } // namespace spen
 } // namespace hardware
 } // namespace samsung
@@ -8,6 +8,14 @@
 
 #include <aidl/vendor/samsung/hardware/spen/BnSPen.h>
 
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "ChargingWatcher.h"
+#include "SeqLock.h"
+#include "SysfsNode.h"
+
 namespace aidl {
 namespace vendor {
 namespace samsung {
@@ -16,12 +24,51 @@ namespace spen {
 
 class SPen : public BnSPen {
 public:
-    SPen();
+    /*
+     * root is prepended to every sysfs and EFS path, so the HAL can run
+     * against a fake tree, e.g. on a host.
+     */
+    explicit SPen(const std::string& root = "");
 
     ndk::ScopedAStatus setCharging(bool in_charging, bool *_aidl_return) override;
     ndk::ScopedAStatus isCharging(bool *_aidl_return) override;
     ndk::ScopedAStatus getMACAddress(std::string *_aidl_return) override;
     ndk::ScopedAStatus setMACAddress(const std::string& in_mac) override;
+    ndk::ScopedAStatus registerCallback(const std::shared_ptr<ISPenCallback>& in_callback) override;
+    ndk::ScopedAStatus unregisterCallback(const std::shared_ptr<ISPenCallback>& in_callback) override;
+    ndk::ScopedAStatus getState(SPenState *_aidl_return) override;
+
+private:
+    struct ChargingModeSnapshot {
+        char mode[24];
+        int64_t updatedNs;
+    };
+
+    const char *macAddressPath();
+    bool readChargingMode(std::string *mode);
+    void onChargingModeRead(const std::string& mode);
+    void onChargingChanged(bool charging);
+    static void onCallbackDied(void *cookie);
+
+    SysfsNode mChargingMode;
+    // Last charging mode read from any thread, served by getState().
+    SeqLock<ChargingModeSnapshot> mChargingModeCache;
+    // Serializes changes to the cache and the callbacks they trigger.
+    std::mutex mChargingModeLock;
+
+    const std::string mEfsMACAddressPath;
+    const std::string mLegacyEfsMACAddressPath;
+    // Resolved EFS path and packed value, filled on first use. Kept in
+    // atomics so concurrent binder threads never block each other.
+    std::atomic<const char *> mMACAddressPath;
+    std::atomic<uint64_t> mMACAddress;
+
+    std::mutex mCallbacksLock;
+    std::vector<std::shared_ptr<ISPenCallback>> mCallbacks;
+    ndk::ScopedAIBinder_DeathRecipient mDeathRecipient;
+
+    // Declared last so its thread is stopped before anything it uses goes away.
+    ChargingWatcher mChargingWatcher;
 };
 
 } // namespace spen
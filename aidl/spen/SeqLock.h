@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+/*
+ * Sequence lock for a small trivially copyable value. Readers never block
+ * and retry if they raced with a writer, writers serialize on the sequence.
+ * The value lives in relaxed atomic words so torn reads aren't data races.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+    SeqLock() : mSeq(0) {
+        for (auto& word : mWords) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    T load() const {
+        uint64_t words[kWords];
+        uint32_t seq;
+
+        for (;;) {
+            seq = mSeq.load(std::memory_order_acquire);
+            if (seq & 1) {
+                continue;
+            }
+
+            for (size_t i = 0; i < kWords; i++) {
+                words[i] = mWords[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (mSeq.load(std::memory_order_relaxed) == seq) {
+                break;
+            }
+        }
+
+        T value;
+        memcpy(&value, words, sizeof(value));
+        return value;
+    }
+
+    void store(const T& value) {
+        uint64_t words[kWords] = {};
+        memcpy(words, &value, sizeof(value));
+
+        uint32_t seq = mSeq.load(std::memory_order_relaxed);
+        while ((seq & 1) || !mSeq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                                        std::memory_order_relaxed)) {
+            seq = mSeq.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < kWords; i++) {
+            mWords[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        mSeq.store(seq + 2, std::memory_order_release);
+    }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> mSeq;
+    std::atomic<uint64_t> mWords[kWords];
+};
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
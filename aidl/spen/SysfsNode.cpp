@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "vendor.samsung.hardware.spen-service.davinci"
+
+#include "SysfsNode.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <android-base/logging.h>
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+/* Sysfs attributes are at most a page, ours are a handful of bytes. */
+static constexpr size_t kMaxValueLen = 64;
+
+SysfsNode::SysfsNode(const std::string& path) : mPath(path), mFd(-1) {}
+
+SysfsNode::~SysfsNode() {
+    int fd = mFd.load();
+
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+int SysfsNode::fd() {
+    int fd = mFd.load(std::memory_order_acquire);
+    if (fd >= 0) {
+        return fd;
+    }
+
+    fd = TEMP_FAILURE_RETRY(open(mPath.c_str(), O_RDWR | O_CLOEXEC));
+    if (fd < 0) {
+        PLOG(ERROR) << "Failed to open " << mPath;
+        return -1;
+    }
+
+    /* Another thread may have opened the node meanwhile, keep its fd. */
+    int expected = -1;
+    if (!mFd.compare_exchange_strong(expected, fd, std::memory_order_acq_rel)) {
+        close(fd);
+        return expected;
+    }
+
+    return fd;
+}
+
+bool SysfsNode::read(std::string* value) {
+    int fd = this->fd();
+    if (fd < 0) {
+        return false;
+    }
+
+    char buf[kMaxValueLen];
+    ssize_t len = TEMP_FAILURE_RETRY(pread(fd, buf, sizeof(buf), 0));
+    if (len < 0) {
+        PLOG(ERROR) << "Failed to read " << mPath;
+        return false;
+    }
+
+    while (len > 0 && isspace(static_cast<unsigned char>(buf[len - 1]))) {
+        len--;
+    }
+
+    value->assign(buf, len);
+    return true;
+}
+
+bool SysfsNode::write(const std::string& value) {
+    int fd = this->fd();
+    if (fd < 0) {
+        return false;
+    }
+
+    ssize_t len = TEMP_FAILURE_RETRY(pwrite(fd, value.data(), value.size(), 0));
+    if (len != static_cast<ssize_t>(value.size())) {
+        PLOG(ERROR) << "Failed to write " << mPath;
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+/*
+ * Keeps a sysfs attribute open and accesses it with pread/pwrite at
+ * offset 0, so repeated reads don't pay for open/close on every call.
+ * Safe to use from several threads, the fd stays open until destruction.
+ */
+class SysfsNode {
+public:
+    explicit SysfsNode(const std::string& path);
+    ~SysfsNode();
+
+    SysfsNode(const SysfsNode&) = delete;
+    SysfsNode& operator=(const SysfsNode&) = delete;
+
+    /*
+     * Read the attribute with trailing whitespace stripped.
+     * Returns false if the node can't be opened or read.
+     */
+    bool read(std::string* value);
+    bool write(const std::string& value);
+
+    /*
+     * The underlying fd, for poll(). Returns -1 if the node can't be opened.
+     */
+    int fd();
+
+    const std::string& path() const { return mPath; }
+
+private:
+    const std::string mPath;
+    std::atomic<int> mFd;
+};
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <time.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+static inline int64_t nowNs() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ * Latencies of every call made by the threads of a benchmark run, reported
+ * once the last of them is done. Percentiles don't add up across threads,
+ * so only that thread sets the counters, which google-benchmark sums.
+ */
+class Latencies {
+public:
+    /*
+     * Called by every thread before its loop, which only starts once all
+     * of them got here.
+     */
+    void start(const benchmark::State& state) {
+        if (state.thread_index() == 0) {
+            std::lock_guard<std::mutex> lock(mLock);
+            mSamples.clear();
+            mRunning = state.threads();
+        }
+    }
+
+    void finish(benchmark::State& state, std::vector<int64_t>& samples) {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        mSamples.insert(mSamples.end(), samples.begin(), samples.end());
+        if (--mRunning > 0 || mSamples.empty()) {
+            return;
+        }
+
+        std::sort(mSamples.begin(), mSamples.end());
+        state.counters["p50_ns"] = percentile(50);
+        state.counters["p99_ns"] = percentile(99);
+        state.counters["max_ns"] = mSamples.back();
+    }
+
+    /*
+     * Like finish(), with the share of calls that took up to each bucket
+     * limit on top, a cumulative histogram.
+     */
+    void finishWithHistogram(benchmark::State& state, std::vector<int64_t>& samples) {
+        finish(state, samples);
+
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mRunning > 0 || mSamples.empty()) {
+            return;
+        }
+
+        for (const auto& [limitNs, name] : kBuckets) {
+            size_t count = std::upper_bound(mSamples.begin(), mSamples.end(), limitNs) -
+                    mSamples.begin();
+            state.counters[name] = static_cast<double>(count) / mSamples.size();
+        }
+    }
+
+private:
+    static constexpr std::pair<int64_t, const char *> kBuckets[] = {
+        {1000, "le_1us"},
+        {4000, "le_4us"},
+        {16000, "le_16us"},
+        {64000, "le_64us"},
+        {256000, "le_256us"},
+        {1000000, "le_1ms"},
+        {4000000, "le_4ms"},
+    };
+
+    double percentile(int p) const { return mSamples[(mSamples.size() - 1) * p / 100]; }
+
+    std::mutex mLock;
+    std::vector<int64_t> mSamples;
+    int mRunning = 0;
+};
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
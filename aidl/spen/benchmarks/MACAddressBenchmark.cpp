@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <unistd.h>
+
+#include <string>
+
+#include <android-base/file.h>
+#include <android-base/strings.h>
+#include <benchmark/benchmark.h>
+
+#include "MACAddress.h"
+#include "SPen.h"
+#include "tests/FakeRoot.h"
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+/*
+ * Served from the packed value once the first call read EFS.
+ */
+static void BM_GetMACAddress(benchmark::State& state) {
+    FakeRoot root;
+    std::shared_ptr<SPen> spen = ndk::SharedRefBase::make<SPen>(root.path());
+    std::string mac;
+
+    spen->getMACAddress(&mac);
+    for (auto _ : state) {
+        spen->getMACAddress(&mac);
+        benchmark::DoNotOptimize(mac);
+    }
+}
+BENCHMARK(BM_GetMACAddress);
+
+/*
+ * What every call used to cost, looking for the EFS copy and reading it.
+ */
+static void BM_ReadMACAddressFromEfs(benchmark::State& state) {
+    FakeRoot root;
+    const std::string path = root.path() + FakeRoot::kMACAddressPath;
+    const std::string legacyPath = root.path() + "/efs/spen/blespen_addr";
+    std::string content;
+
+    for (auto _ : state) {
+        if (access(path.c_str(), F_OK) != 0) {
+            access(legacyPath.c_str(), F_OK);
+        }
+        ::android::base::ReadFileToString(path, &content);
+        std::string mac = ::android::base::Trim(content);
+        benchmark::DoNotOptimize(mac);
+    }
+}
+BENCHMARK(BM_ReadMACAddressFromEfs);
+
+static void BM_UnpackMACAddress(benchmark::State& state) {
+    uint64_t packed = 0;
+    packMACAddress("01:23:45:67:89:AB", &packed);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(unpackMACAddress(packed));
+    }
+}
+BENCHMARK(BM_UnpackMACAddress);
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
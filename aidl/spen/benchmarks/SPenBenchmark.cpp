@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Latencies.h"
+#include "SPen.h"
+#include "tests/FakeRoot.h"
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+class Callback : public ISPenCallback {
+public:
+    ndk::ScopedAStatus onChargingChanged(bool) override { return ndk::ScopedAStatus::ok(); }
+};
+
+/*
+ * Every AIDL method of the real SPen on a fake root, with calls per second
+ * and the latency distribution of the calls.
+ */
+template <typename Call>
+static void measure(benchmark::State& state, Call call) {
+    FakeRoot root;
+    std::shared_ptr<SPen> spen = ndk::SharedRefBase::make<SPen>(root.path());
+    Latencies latencies;
+    std::vector<int64_t> samples;
+
+    latencies.start(state);
+    for (auto _ : state) {
+        int64_t startNs = nowNs();
+        call(*spen);
+        samples.push_back(nowNs() - startNs);
+    }
+    latencies.finishWithHistogram(state, samples);
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_SetCharging(benchmark::State& state) {
+    bool charging = false;
+
+    measure(state, [&](SPen& spen) { spen.setCharging(!charging, &charging); });
+}
+BENCHMARK(BM_SetCharging);
+
+static void BM_IsCharging(benchmark::State& state) {
+    measure(state, [](SPen& spen) {
+        bool charging;
+        spen.isCharging(&charging);
+    });
+}
+BENCHMARK(BM_IsCharging);
+
+static void BM_GetState(benchmark::State& state) {
+    measure(state, [](SPen& spen) {
+        SPenState spenState;
+        spen.getState(&spenState);
+    });
+}
+BENCHMARK(BM_GetState);
+
+static void BM_GetMACAddressMethod(benchmark::State& state) {
+    measure(state, [](SPen& spen) {
+        std::string mac;
+        spen.getMACAddress(&mac);
+    });
+}
+BENCHMARK(BM_GetMACAddressMethod);
+
+static void BM_SetMACAddress(benchmark::State& state) {
+    measure(state, [](SPen& spen) { spen.setMACAddress("01:23:45:67:89:AB"); });
+}
+BENCHMARK(BM_SetMACAddress);
+
+static void BM_RegisterUnregisterCallback(benchmark::State& state) {
+    std::shared_ptr<Callback> callback = ndk::SharedRefBase::make<Callback>();
+
+    measure(state, [&](SPen& spen) {
+        spen.registerCallback(callback);
+        spen.unregisterCallback(callback);
+    });
+}
+BENCHMARK(BM_RegisterUnregisterCallback);
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
@@ -11,11 +11,20 @@
 #include <android/binder_manager.h>
 #include <android/binder_process.h>
 #include <android-base/logging.h>
+#include <android-base/properties.h>
 
 using ::aidl::vendor::samsung::hardware::spen::SPen;
 
 int main() {
-    ABinderProcess_setThreadPoolMaxThreadCount(0);
+    // Extra binder threads besides the main one, so a slow EFS access
+    // doesn't hold up every other client.
+    uint32_t threads = ::android::base::GetUintProperty<uint32_t>("ro.vendor.spen.binder_threads", 0);
+
+    ABinderProcess_setThreadPoolMaxThreadCount(threads);
+    if (threads > 0) {
+        ABinderProcess_startThreadPool();
+    }
+
     std::shared_ptr<SPen> spen = ndk::SharedRefBase::make<SPen>();
 
     const std::string instance = std::string() + SPen::descriptor + "/default";
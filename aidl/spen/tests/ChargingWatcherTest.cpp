@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "ChargingWatcher.h"
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+using ::android::base::WriteStringToFile;
+
+static constexpr auto kTimeout = std::chrono::seconds(5);
+// Longer than the watcher's fallback interval.
+static constexpr auto kQuietPeriod = std::chrono::milliseconds(1500);
+
+class ChargingWatcherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mPath = std::string(mDir.path) + "/epen_ble_charging_mode";
+        ASSERT_TRUE(WriteStringToFile("NONE\n", mPath));
+    }
+
+    void onModeRead(const std::string& mode) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mModes.push_back(mode);
+        mCondition.notify_all();
+    }
+
+    bool waitForModes(size_t count, std::chrono::milliseconds timeout = kTimeout) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mCondition.wait_for(lock, timeout, [&] { return mModes.size() >= count; });
+    }
+
+    TemporaryDir mDir;
+    std::string mPath;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::vector<std::string> mModes;
+};
+
+TEST_F(ChargingWatcherTest, ReportsChanges) {
+    ChargingWatcher watcher(mPath, [this](const std::string& mode) { onModeRead(mode); });
+
+    watcher.setEnabled(true);
+    ASSERT_TRUE(waitForModes(1));
+
+    ASSERT_TRUE(WriteStringToFile("CHARGE\n", mPath));
+    watcher.refresh();
+    ASSERT_TRUE(waitForModes(2));
+
+    // Re-reading an unchanged mode isn't reported.
+    watcher.refresh();
+    watcher.refresh();
+    ASSERT_TRUE(WriteStringToFile("NONE\n", mPath));
+    watcher.refresh();
+    ASSERT_TRUE(waitForModes(3));
+
+    std::lock_guard<std::mutex> lock(mLock);
+    EXPECT_EQ((std::vector<std::string>{"NONE", "CHARGE", "NONE"}), mModes);
+}
+
+TEST_F(ChargingWatcherTest, SilentWhileDisabled) {
+    ChargingWatcher watcher(mPath, [this](const std::string& mode) { onModeRead(mode); });
+
+    watcher.refresh();
+    ASSERT_FALSE(waitForModes(1, kQuietPeriod));
+}
+
+TEST_F(ChargingWatcherTest, FallsBackToPolling) {
+    ChargingWatcher watcher(mPath, [this](const std::string& mode) { onModeRead(mode); });
+
+    watcher.setEnabled(true);
+    ASSERT_TRUE(waitForModes(1));
+
+    // A regular file never notifies, the change is picked up on the timer.
+    ASSERT_TRUE(WriteStringToFile("CHARGE\n", mPath));
+    ASSERT_TRUE(waitForModes(2));
+
+    std::lock_guard<std::mutex> lock(mLock);
+    EXPECT_EQ("CHARGE", mModes.back());
+}
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
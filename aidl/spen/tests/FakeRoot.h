@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <sys/stat.h>
+
+#include <string>
+
+#include <android-base/file.h>
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+/*
+ * The sysfs and EFS files SPen uses, as plain files in a temporary
+ * directory to pass to it as its root. Point TMPDIR at a tmpfs on a host
+ * to keep the disk out of the numbers.
+ */
+class FakeRoot {
+public:
+    static constexpr const char *kChargingModePath = "/sys/class/sec/sec_epen/epen_ble_charging_mode";
+    static constexpr const char *kMACAddressPath = "/mnt/vendor/efs/spen/blespen_addr";
+
+    FakeRoot() : mRoot(mDir.path) {
+        makeParents(kChargingModePath);
+        makeParents(kMACAddressPath);
+        set(kChargingModePath, "NONE\n");
+        set(kMACAddressPath, "01:23:45:67:89:AB\n");
+    }
+
+    const std::string& path() const { return mRoot; }
+
+    bool set(const char *path, const std::string& value) {
+        return ::android::base::WriteStringToFile(value, mRoot + path);
+    }
+
+private:
+    void makeParents(const std::string& path) {
+        for (size_t end = path.find('/', 1); end != std::string::npos;
+                end = path.find('/', end + 1)) {
+            mkdir((mRoot + path.substr(0, end)).c_str(), 0755);
+        }
+    }
+
+    TemporaryDir mDir;
+    const std::string mRoot;
+};
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "MACAddress.h"
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+TEST(MACAddressTest, RoundTrips) {
+    for (const std::string mac : {"00:00:00:00:00:00", "01:23:45:67:89:AB", "ff:ff:ff:ff:ff:ff",
+                                  "DE:AD:BE:EF:00:01", "0a:1b:2c:3d:4e:5f", "AA:BB:CC:DD:EE:0f",
+                                  "aB:Cd:eF:Ab:cD:Ef", "fA:00:0b:C0:0d:E9"}) {
+        uint64_t packed = 0;
+
+        ASSERT_TRUE(packMACAddress(mac, &packed)) << mac;
+        EXPECT_TRUE(packed & kMACAddressCached) << mac;
+        EXPECT_EQ(mac, unpackMACAddress(packed));
+    }
+}
+
+TEST(MACAddressTest, PacksBytesInOrder) {
+    uint64_t packed = 0;
+
+    ASSERT_TRUE(packMACAddress("01:23:45:67:89:AB", &packed));
+    EXPECT_EQ(0x0123456789abULL, packed & 0xffffffffffffULL);
+    EXPECT_EQ(0ULL, packed >> kMACAddressCaseShift & 0xfff);
+}
+
+/*
+ * Every digit keeps its own case, so mixed case addresses aren't folded.
+ */
+TEST(MACAddressTest, KeepsCasePerDigit) {
+    uint64_t packed = 0;
+
+    ASSERT_TRUE(packMACAddress("Aa:00:00:00:00:0f", &packed));
+    EXPECT_EQ(0x401ULL, packed >> kMACAddressCaseShift & 0xfff);
+    EXPECT_EQ("Aa:00:00:00:00:0f", unpackMACAddress(packed));
+}
+
+/*
+ * Nothing cached must never be mistaken for the all zero address.
+ */
+TEST(MACAddressTest, ZeroAddressIsCached) {
+    uint64_t packed = 0;
+
+    ASSERT_TRUE(packMACAddress("00:00:00:00:00:00", &packed));
+    EXPECT_NE(0ULL, packed);
+}
+
+TEST(MACAddressTest, RejectsMalformed) {
+    for (const std::string mac : {"", "01:23:45:67:89", "01:23:45:67:89:AB:", "01-23-45-67-89-AB",
+                                  "0123456789AB12345", "01:23:45:67:89:AG", "01:23:45:67:89:A",
+                                  " 1:23:45:67:89:AB", "01:23:45:67:89:AB\n"}) {
+        uint64_t packed = 42;
+
+        EXPECT_FALSE(packMACAddress(mac, &packed)) << mac;
+        EXPECT_EQ(42ULL, packed) << mac;
+    }
+}
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
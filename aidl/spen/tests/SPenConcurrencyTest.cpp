@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SPen.h"
+#include "tests/FakeRoot.h"
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+static int64_t nowNs() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ * Many clients calling into one SPen at once, as binder threads of the
+ * service would. The calls are made in process, which leaves out the
+ * binder transaction itself but keeps every bit of contention within SPen.
+ * The latency of every call is kept, and p50, p99 and max are recorded
+ * with the test result.
+ */
+class SPenConcurrencyTest : public ::testing::Test {
+protected:
+    static constexpr int kNumClients = 16;
+    static constexpr int kCallsPerClient = 2000;
+
+    void SetUp() override { mSPen = ndk::SharedRefBase::make<SPen>(mRoot.path()); }
+
+    /*
+     * Run call(client, n) from every client at once, and return the sorted
+     * latencies of the clients measured.
+     */
+    template <typename Call>
+    std::vector<int64_t> runClients(int firstMeasured, Call call) {
+        std::atomic<int> numReady(0);
+        std::vector<std::vector<int64_t>> samples(kNumClients);
+        std::vector<std::thread> clients;
+
+        for (int client = 0; client < kNumClients; client++) {
+            clients.emplace_back([&, client] {
+                samples[client].reserve(kCallsPerClient);
+                numReady++;
+                while (numReady.load() < kNumClients) {
+                    std::this_thread::yield();
+                }
+
+                for (int n = 0; n < kCallsPerClient; n++) {
+                    int64_t startNs = nowNs();
+                    call(client, n);
+                    samples[client].push_back(nowNs() - startNs);
+                }
+            });
+        }
+
+        std::vector<int64_t> latencies;
+        for (int client = 0; client < kNumClients; client++) {
+            clients[client].join();
+            if (client >= firstMeasured) {
+                latencies.insert(latencies.end(), samples[client].begin(), samples[client].end());
+            }
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        return latencies;
+    }
+
+    void report(const std::vector<int64_t>& latencies) {
+        ASSERT_FALSE(latencies.empty());
+
+        int64_t p50 = latencies[(latencies.size() - 1) * 50 / 100];
+        int64_t p99 = latencies[(latencies.size() - 1) * 99 / 100];
+        RecordProperty("p50_ns", std::to_string(p50));
+        RecordProperty("p99_ns", std::to_string(p99));
+        RecordProperty("max_ns", std::to_string(latencies.back()));
+        printf("%d clients, %zu calls: p50 %lldns, p99 %lldns, max %lldns\n", kNumClients,
+               latencies.size(), static_cast<long long>(p50), static_cast<long long>(p99),
+               static_cast<long long>(latencies.back()));
+    }
+
+    FakeRoot mRoot;
+    std::shared_ptr<SPen> mSPen;
+};
+
+TEST_F(SPenConcurrencyTest, ConcurrentReads) {
+    std::atomic<int> numWrong(0);
+
+    report(runClients(0, [&](int client, int n) {
+        bool charging = true;
+        SPenState state;
+        std::string mac;
+
+        switch ((client + n) % 3) {
+            case 0:
+                mSPen->isCharging(&charging);
+                break;
+            case 1:
+                mSPen->getState(&state);
+                charging = state.charging;
+                mac = state.macAddress;
+                break;
+            case 2:
+                mSPen->getMACAddress(&mac);
+                charging = false;
+                break;
+        }
+
+        if (charging || (!mac.empty() && mac != "01:23:45:67:89:AB")) {
+            numWrong++;
+        }
+    }));
+
+    EXPECT_EQ(0, numWrong.load());
+}
+
+/*
+ * One client keeps rewriting the MAC address, each time synced to EFS,
+ * while the others read it. Only the readers are measured, and they must
+ * only ever see one of the addresses written, never a torn one.
+ */
+TEST_F(SPenConcurrencyTest, ReadsWhileSettingMACAddress) {
+    const std::string kAddresses[] = {"01:23:45:67:89:AB", "fe:dc:ba:98:76:54"};
+    std::atomic<int> numTorn(0);
+
+    report(runClients(1, [&](int client, int n) {
+        if (client == 0) {
+            mSPen->setMACAddress(kAddresses[n % 2]);
+            return;
+        }
+
+        std::string mac;
+        mSPen->getMACAddress(&mac);
+        if (mac != kAddresses[0] && mac != kAddresses[1]) {
+            numTorn++;
+        }
+    }));
+
+    EXPECT_EQ(0, numTorn.load());
+
+    // What is cached is what EFS holds.
+    std::string mac, stored;
+    mSPen->getMACAddress(&mac);
+    ASSERT_TRUE(::android::base::ReadFileToString(mRoot.path() + FakeRoot::kMACAddressPath,
+                                                  &stored));
+    EXPECT_EQ(mac + "\n", stored);
+}
+
+/*
+ * One client keeps flipping the charging mode node, while the others ask
+ * for the state. Each state must be consistent within itself, and no
+ * client may see it go back in time.
+ */
+TEST_F(SPenConcurrencyTest, ReadsWhileChargingModeChanges) {
+    std::atomic<int> numInconsistent(0);
+    std::vector<int64_t> lastUpdateNs(kNumClients, 0);
+
+    // Rewritten in place like a sysfs attribute, truncating would let readers see it empty.
+    int fd = open((mRoot.path() + FakeRoot::kChargingModePath).c_str(), O_WRONLY | O_CLOEXEC);
+    ASSERT_GE(fd, 0);
+
+    report(runClients(1, [&](int client, int n) {
+        if (client == 0) {
+            pwrite(fd, n % 2 ? "CHARGE\n" : "NONE  \n", 7, 0);
+            return;
+        }
+
+        SPenState state;
+        mSPen->getState(&state);
+        if (state.charging != (state.chargingMode == "CHARGE") ||
+                (state.chargingMode != "CHARGE" && state.chargingMode != "NONE") ||
+                state.lastUpdateNs < lastUpdateNs[client]) {
+            numInconsistent++;
+        }
+        lastUpdateNs[client] = state.lastUpdateNs;
+    }));
+
+    close(fd);
+
+    EXPECT_EQ(0, numInconsistent.load());
+}
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SeqLock.h"
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+// Spans several words, so a torn read would show up as a mismatch.
+struct Value {
+    uint32_t words[7];
+};
+
+static Value make(uint32_t n) {
+    Value value;
+
+    for (auto& word : value.words) {
+        word = n;
+    }
+
+    return value;
+}
+
+TEST(SeqLockTest, StartsZeroed) {
+    SeqLock<Value> lock;
+
+    Value value = lock.load();
+    for (auto word : value.words) {
+        EXPECT_EQ(0u, word);
+    }
+}
+
+TEST(SeqLockTest, LoadsLastStore) {
+    SeqLock<Value> lock;
+
+    lock.store(make(1));
+    lock.store(make(2));
+
+    Value value = lock.load();
+    for (auto word : value.words) {
+        EXPECT_EQ(2u, word);
+    }
+}
+
+TEST(SeqLockTest, NoTornReads) {
+    static constexpr int kWriters = 2;
+    static constexpr int kReaders = 4;
+    static constexpr uint32_t kStores = 100000;
+
+    SeqLock<Value> lock;
+    std::atomic<int> writersDone(0);
+    std::atomic<bool> torn(false);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < kWriters; i++) {
+        threads.emplace_back([&, i] {
+            for (uint32_t n = 1; n <= kStores; n++) {
+                lock.store(make(n * kWriters + i));
+            }
+            writersDone++;
+        });
+    }
+
+    for (int i = 0; i < kReaders; i++) {
+        threads.emplace_back([&] {
+            while (writersDone < kWriters) {
+                Value value = lock.load();
+                for (auto word : value.words) {
+                    if (word != value.words[0]) {
+                        torn = true;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_FALSE(torn);
+}
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2022 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "SysfsNode.h"
+
+namespace aidl {
+namespace vendor {
+namespace samsung {
+namespace hardware {
+namespace spen {
+
+using ::android::base::ReadFileToString;
+using ::android::base::WriteStringToFile;
+
+/*
+ * A regular file in a temporary directory stands in for the attribute.
+ */
+class SysfsNodeTest : public ::testing::Test {
+protected:
+    void SetUp() override { mPath = std::string(mDir.path) + "/epen_ble_charging_mode"; }
+
+    TemporaryDir mDir;
+    std::string mPath;
+};
+
+TEST_F(SysfsNodeTest, ReadStripsTrailingWhitespace) {
+    ASSERT_TRUE(WriteStringToFile("CHARGE \n", mPath));
+    SysfsNode node(mPath);
+    std::string value;
+
+    ASSERT_TRUE(node.read(&value));
+    EXPECT_EQ("CHARGE", value);
+}
+
+TEST_F(SysfsNodeTest, OpensOnce) {
+    ASSERT_TRUE(WriteStringToFile("NONE\n", mPath));
+    SysfsNode node(mPath);
+    std::string value;
+
+    int fd = node.fd();
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(node.read(&value));
+    ASSERT_TRUE(node.write("1\n"));
+    EXPECT_EQ(fd, node.fd());
+
+    // Still reading through the fd opened first, not the path.
+    ASSERT_TRUE(WriteStringToFile("NONE\n", mPath));
+    ASSERT_EQ(0, unlink(mPath.c_str()));
+    ASSERT_TRUE(WriteStringToFile("CHARGE\n", mPath));
+    ASSERT_TRUE(node.read(&value));
+    EXPECT_EQ("NONE", value);
+    EXPECT_EQ(fd, node.fd());
+}
+
+TEST_F(SysfsNodeTest, ReadsFromOffsetZero) {
+    ASSERT_TRUE(WriteStringToFile("NONE\n", mPath));
+    SysfsNode node(mPath);
+    std::string value;
+
+    ASSERT_TRUE(node.read(&value));
+    ASSERT_TRUE(node.read(&value));
+    EXPECT_EQ("NONE", value);
+
+    // Changed behind its back, e.g. by the driver.
+    ASSERT_TRUE(WriteStringToFile("CHARGE\n", mPath));
+    ASSERT_TRUE(node.read(&value));
+    EXPECT_EQ("CHARGE", value);
+}
+
+TEST_F(SysfsNodeTest, WritesAtOffsetZero) {
+    ASSERT_TRUE(WriteStringToFile("", mPath));
+    SysfsNode node(mPath);
+    std::string content;
+
+    ASSERT_TRUE(node.write("0\n"));
+    ASSERT_TRUE(node.write("1\n"));
+    ASSERT_TRUE(ReadFileToString(mPath, &content));
+    EXPECT_EQ("1\n", content);
+}
+
+TEST_F(SysfsNodeTest, MissingNode) {
+    SysfsNode node(mPath);
+    std::string value = "unchanged";
+
+    EXPECT_EQ(-1, node.fd());
+    EXPECT_FALSE(node.read(&value));
+    EXPECT_EQ("unchanged", value);
+    EXPECT_FALSE(node.write("1\n"));
+
+    // Opened once it shows up, e.g. after the driver probed.
+    ASSERT_TRUE(WriteStringToFile("NONE\n", mPath));
+    ASSERT_TRUE(node.read(&value));
+    EXPECT_EQ("NONE", value);
+    EXPECT_GE(node.fd(), 0);
+}
+
+TEST_F(SysfsNodeTest, UnopenableNode) {
+    ASSERT_EQ(0, mkdir(mPath.c_str(), 0755));
+    SysfsNode node(mPath);
+    std::string value;
+
+    EXPECT_EQ(-1, node.fd());
+    EXPECT_FALSE(node.read(&value));
+    EXPECT_FALSE(node.write("1\n"));
+}
+
+TEST_F(SysfsNodeTest, ShortWrite) {
+    ASSERT_TRUE(WriteStringToFile("", mPath));
+    SysfsNode node(mPath);
+    ASSERT_GE(node.fd(), 0);
+
+    // Past the file size limit, nothing gets written.
+    struct rlimit limit;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &limit));
+    struct rlimit lowered = {.rlim_cur = 1, .rlim_max = limit.rlim_max};
+    signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &lowered));
+    bool written = node.write("CHARGE\n");
+    setrlimit(RLIMIT_FSIZE, &limit);
+
+    EXPECT_FALSE(written);
+}
+
+} // namespace spen
+} // namespace hardware
+} // namespace samsung
+} // namespace vendor
+} // namespace aidl
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CameraInfoStore"
+
+#include "CameraInfoStore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <cutils/properties.h>
+#include <log/log.h>
+#include <system/camera_metadata.h>
+#include <utils/Errors.h>
+
+const uint32_t kStoreMagic = 0x49435353; // "SSCI"
+const uint32_t kStoreVersion = 1;
+const size_t kStoreAlignment = 8;
+
+struct StoreHeader {
+    uint32_t magic;
+    uint32_t version;
+    char key[256];
+    uint32_t numEntries;
+    uint32_t reserved;
+};
+
+struct StoreEntry {
+    int32_t id;
+    int32_t facing;
+    int32_t orientation;
+    uint32_t deviceVersion;
+    int32_t resourceCost;
+    uint32_t numConflictingDevices;
+    // NUL-separated device names
+    uint64_t conflictingDevicesOffset;
+    uint64_t conflictingDevicesSize;
+    uint64_t metadataOffset;
+    uint64_t metadataSize;
+};
+
+/*
+ * Anything that could change what the module reports invalidates the store.
+ */
+static void makeKey(const camera_module_t *module, char (&key)[256]) {
+    char fingerprint[PROPERTY_VALUE_MAX];
+
+    property_get("ro.vendor.build.fingerprint", fingerprint, "");
+    memset(key, 0, sizeof(key));
+    snprintf(key, sizeof(key), "%s|%s|%x", fingerprint,
+             module->common.name ? module->common.name : "",
+             module->common.module_api_version);
+}
+
+static size_t align(size_t offset) {
+    return (offset + kStoreAlignment - 1) & ~(kStoreAlignment - 1);
+}
+
+bool CameraInfoStore::load(const camera_module_t *module, std::map<int, camera_info> *infos,
+                           const char *path) {
+    // Backing storage for conflicting_devices, alive as long as the mapping.
+    static std::vector<std::vector<char *>> sConflictingDevices;
+
+    int fd = TEMP_FAILURE_RETRY(open(path, O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            ALOGW("Failed to open %s: %s", path, strerror(errno));
+        }
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(StoreHeader))) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        ALOGW("Failed to map %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    const uint8_t *base = static_cast<const uint8_t *>(map);
+    const StoreHeader *header = reinterpret_cast<const StoreHeader *>(base);
+    char key[256];
+    makeKey(module, key);
+
+    if (header->magic != kStoreMagic || header->version != kStoreVersion ||
+            memcmp(header->key, key, sizeof(key)) != 0 ||
+            header->numEntries > (size - sizeof(StoreHeader)) / sizeof(StoreEntry)) {
+        ALOGI("Ignoring stale camera info store");
+        munmap(map, size);
+        return false;
+    }
+
+    const StoreEntry *entries = reinterpret_cast<const StoreEntry *>(header + 1);
+    std::map<int, camera_info> loaded;
+    std::vector<std::vector<char *>> conflictingDevices;
+
+    for (uint32_t n = 0; n < header->numEntries; n++) {
+        const StoreEntry& entry = entries[n];
+
+        if (entry.metadataOffset % kStoreAlignment != 0 || entry.metadataOffset > size ||
+                entry.metadataSize > size - entry.metadataOffset ||
+                entry.conflictingDevicesOffset > size ||
+                entry.conflictingDevicesSize > size - entry.conflictingDevicesOffset) {
+            ALOGW("Corrupt camera info store entry for ID %d", entry.id);
+            munmap(map, size);
+            return false;
+        }
+
+        const camera_metadata_t *metadata = nullptr;
+        if (entry.metadataSize > 0) {
+            metadata = reinterpret_cast<const camera_metadata_t *>(base + entry.metadataOffset);
+            size_t metadataSize = entry.metadataSize;
+            if (validate_camera_metadata_structure(metadata, &metadataSize) != 0) {
+                ALOGW("Invalid stored metadata for ID %d", entry.id);
+                munmap(map, size);
+                return false;
+            }
+        }
+
+        std::vector<char *> devices;
+        const char *names = reinterpret_cast<const char *>(base + entry.conflictingDevicesOffset);
+        for (size_t offset = 0; devices.size() < entry.numConflictingDevices &&
+                offset < entry.conflictingDevicesSize;) {
+            size_t len = strnlen(names + offset, entry.conflictingDevicesSize - offset);
+            if (offset + len == entry.conflictingDevicesSize) {
+                break;
+            }
+            devices.push_back(const_cast<char *>(names + offset));
+            offset += len + 1;
+        }
+        if (devices.size() != entry.numConflictingDevices) {
+            ALOGW("Corrupt conflicting devices for ID %d", entry.id);
+            munmap(map, size);
+            return false;
+        }
+
+        camera_info info = {};
+        info.facing = entry.facing;
+        info.orientation = entry.orientation;
+        info.device_version = entry.deviceVersion;
+        info.static_camera_characteristics = metadata;
+        info.resource_cost = entry.resourceCost;
+        info.conflicting_devices_length = devices.size();
+        conflictingDevices.push_back(std::move(devices));
+        info.conflicting_devices = conflictingDevices.back().data();
+
+        loaded[entry.id] = info;
+    }
+
+    // Moving the vectors keeps their buffers, so the pointers above stay valid.
+    for (auto& devices : conflictingDevices) {
+        sConflictingDevices.push_back(std::move(devices));
+    }
+    infos->insert(loaded.begin(), loaded.end());
+
+    ALOGI("Loaded camera info for %u IDs from %s", header->numEntries, path);
+    return true;
+}
+
+bool CameraInfoStore::save(const camera_module_t *module, const std::map<int, camera_info>& infos,
+                           const char *path) {
+    StoreHeader header = {};
+    std::vector<StoreEntry> entries;
+    std::vector<uint8_t> data;
+    size_t dataStart = sizeof(StoreHeader) + infos.size() * sizeof(StoreEntry);
+
+    header.magic = kStoreMagic;
+    header.version = kStoreVersion;
+    makeKey(module, header.key);
+    header.numEntries = infos.size();
+
+    for (const auto& [id, info] : infos) {
+        StoreEntry entry = {};
+        entry.id = id;
+        entry.facing = info.facing;
+        entry.orientation = info.orientation;
+        entry.deviceVersion = info.device_version;
+        entry.resourceCost = info.resource_cost;
+        entry.numConflictingDevices = info.conflicting_devices_length;
+
+        entry.conflictingDevicesOffset = dataStart + data.size();
+        for (size_t n = 0; n < info.conflicting_devices_length; n++) {
+            const char *name = info.conflicting_devices[n];
+            data.insert(data.end(), name, name + strlen(name) + 1);
+        }
+        entry.conflictingDevicesSize = dataStart + data.size() - entry.conflictingDevicesOffset;
+
+        data.resize(align(dataStart + data.size()) - dataStart);
+        entry.metadataOffset = dataStart + data.size();
+        if (info.static_camera_characteristics != nullptr) {
+            const uint8_t *metadata =
+                    reinterpret_cast<const uint8_t *>(info.static_camera_characteristics);
+            entry.metadataSize = get_camera_metadata_size(info.static_camera_characteristics);
+            data.insert(data.end(), metadata, metadata + entry.metadataSize);
+        }
+
+        entries.push_back(entry);
+    }
+
+    std::string tmpPath = std::string(path) + ".tmp";
+    int fd = TEMP_FAILURE_RETRY(
+            open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0660));
+    if (fd < 0) {
+        ALOGW("Failed to create %s: %s", tmpPath.c_str(), strerror(errno));
+        return false;
+    }
+
+    bool ok = write(fd, &header, sizeof(header)) == sizeof(header) &&
+            write(fd, entries.data(), entries.size() * sizeof(StoreEntry)) ==
+                    static_cast<ssize_t>(entries.size() * sizeof(StoreEntry)) &&
+            write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()) &&
+            fsync(fd) == 0;
+    close(fd);
+
+    if (!ok || rename(tmpPath.c_str(), path) != 0) {
+        ALOGW("Failed to write %s: %s", path, strerror(errno));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    ALOGI("Saved camera info for %zu IDs to %s", infos.size(), path);
+    return true;
+}
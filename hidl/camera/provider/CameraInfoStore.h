@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_INFO_STORE_H
+#define CAMERA_INFO_STORE_H
+
+#include <map>
+
+#include <hardware/camera_common.h>
+
+/*
+ * On-disk copy of the camera_info of every ID, including the static
+ * characteristics, keyed by the vendor build fingerprint and the module.
+ * A stale or damaged file is ignored and the module gets probed live.
+ */
+class CameraInfoStore {
+public:
+    static constexpr const char *kDefaultPath = "/data/vendor/camera/camera_info.cache";
+
+    /*
+     * Load the stored infos into infos. The metadata points into a
+     * read-only mapping that stays around for the lifetime of the process.
+     */
+    static bool load(const camera_module_t *module, std::map<int, camera_info> *infos,
+                     const char *path = kDefaultPath);
+
+    /*
+     * Written next to path first and renamed over it.
+     */
+    static bool save(const camera_module_t *module, const std::map<int, camera_info>& infos,
+                     const char *path = kDefaultPath);
+};
+
+#endif // CAMERA_INFO_STORE_H
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CameraPrewarmer"
+
+#include "CameraPrewarmer.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <android-base/properties.h>
+#include <cutils/properties.h>
+#include <log/log.h>
+#include <utils/Timers.h>
+
+#include "OpenArbiter.h"
+
+// How long a camera opened ahead is kept for the framework, off if 0.
+const char *kPrewarmWindowProp = "ro.vendor.camera.provider.prewarm_ms";
+// Set to 1 by the power HAL on CAMERA_LAUNCH, back to 0 once the boost is over.
+const char *kPrewarmTriggerProp = "vendor.camera.provider.prewarm";
+
+static std::mutex sLock;
+static std::condition_variable sCondition;
+static camera_module_t *sModule;
+static int (*sVendorOpen)(const hw_module_t *module, const char *id, hw_device_t **device);
+static int sId = -1;
+// The device is being opened or closed outside of sLock.
+static bool sBusy;
+// Another ID started opening while the device was.
+static bool sCancelled;
+static hw_device_t *sDevice;
+// Devices the framework opened and didn't close yet.
+static int sNumOpen;
+// When sDevice was ready for the framework.
+static nsecs_t sReadyNs;
+
+/*
+ * The first camera facing back, -1 if there is none. get_camera_info() of
+ * the module is served from SamsungCameraModule's cache.
+ */
+static int backCameraId() {
+    int numCameras = sModule->get_number_of_cameras();
+
+    for (int id = 0; id < numCameras; id++) {
+        struct camera_info info;
+
+        if (sModule->get_camera_info(id, &info) == 0 && info.facing == CAMERA_FACING_BACK) {
+            return id;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Close the device outside of sLock, and give back its cost once it is.
+ */
+static void closeLocked(std::unique_lock<std::mutex>& lock, hw_device_t *device) {
+    sBusy = true;
+    lock.unlock();
+
+    device->close(device);
+    OpenArbiter::release(sId);
+
+    lock.lock();
+    sBusy = false;
+    sCondition.notify_all();
+}
+
+/*
+ * Open the camera and keep it until claimed or the window is over.
+ */
+static void warm(int windowMs) {
+    std::unique_lock<std::mutex> lock(sLock);
+    if (sBusy || sDevice != nullptr || sNumOpen > 0) {
+        return;
+    }
+    // The blob has it open all the same, so it counts against what else may be.
+    if (!OpenArbiter::acquire(sId)) {
+        return;
+    }
+    sBusy = true;
+    sCancelled = false;
+    lock.unlock();
+
+    char id[16];
+    snprintf(id, sizeof(id), "%d", sId);
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    hw_device_t *device = nullptr;
+    int rc = sVendorOpen(&sModule->common, id, &device);
+
+    lock.lock();
+    sBusy = false;
+    sCondition.notify_all();
+
+    if (rc != 0) {
+        ALOGW("Failed to open ID=%d ahead: %d", sId, rc);
+        OpenArbiter::release(sId);
+        return;
+    }
+
+    if (sCancelled) {
+        ALOGI("Another ID is being opened, closing ID=%d opened ahead", sId);
+        closeLocked(lock, device);
+        return;
+    }
+
+    sDevice = device;
+    sReadyNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    ALOGI("Opened ID=%d ahead in %.2fms", sId, (sReadyNs - start) / 1e6);
+
+    if (sCondition.wait_for(lock, std::chrono::milliseconds(windowMs),
+                            [device] { return sDevice != device; })) {
+        return;
+    }
+
+    sDevice = nullptr;
+    ALOGI("ID=%d wasn't opened within %dms, closing it", sId, windowMs);
+    closeLocked(lock, device);
+}
+
+static void watch(int windowMs) {
+    while (true) {
+        android::base::WaitForProperty(kPrewarmTriggerProp, "1");
+
+        // Looked up once needed, the provider has long been up by the first hint.
+        if (sId < 0) {
+            int id = backCameraId();
+            if (id < 0) {
+                ALOGW("No back camera to open ahead");
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(sLock);
+            sId = id;
+        }
+
+        warm(windowMs);
+        // Once per hint, it stays set for as long as the boost lasts.
+        android::base::WaitForProperty(kPrewarmTriggerProp, "0");
+    }
+}
+
+bool CameraPrewarmer::isEnabled() {
+    static bool enabled = property_get_int32(kPrewarmWindowProp, 0) > 0;
+
+    return enabled;
+}
+
+void CameraPrewarmer::start(camera_module_t *module,
+                            int (*vendorOpen)(const hw_module_t *module, const char *id,
+                                              hw_device_t **device)) {
+    {
+        std::lock_guard<std::mutex> lock(sLock);
+        if (sModule != nullptr) {
+            return;
+        }
+        sModule = module;
+        sVendorOpen = vendorOpen;
+    }
+
+    std::thread(watch, property_get_int32(kPrewarmWindowProp, 0)).detach();
+}
+
+hw_device_t *CameraPrewarmer::claim(int id) {
+    if (!isEnabled()) {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(sLock);
+    sNumOpen++;
+
+    if (id != sId) {
+        // Not worth waiting for, an open still in progress closes once done.
+        sCancelled = true;
+
+        hw_device_t *device = sDevice;
+        if (device != nullptr) {
+            sDevice = nullptr;
+            ALOGI("ID=%d is being opened, closing ID=%d opened ahead", id, sId);
+            closeLocked(lock, device);
+        }
+
+        return nullptr;
+    }
+
+    sCondition.wait(lock, [] { return !sBusy; });
+
+    hw_device_t *device = sDevice;
+    if (device == nullptr) {
+        return nullptr;
+    }
+
+    sDevice = nullptr;
+    sCondition.notify_all();
+
+    ALOGI("Handing over ID=%d opened %.2fms ago", id,
+          (systemTime(SYSTEM_TIME_MONOTONIC) - sReadyNs) / 1e6);
+    return device;
+}
+
+void CameraPrewarmer::settle() {
+    if (!isEnabled()) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(sLock);
+    sCondition.wait(lock, [] { return !sBusy; });
+}
+
+void CameraPrewarmer::closed() {
+    if (!isEnabled()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(sLock);
+    sNumOpen--;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAMERA_PREWARMER_H
+#define CAMERA_PREWARMER_H
+
+#include <hardware/camera_common.h>
+
+/*
+ * Opens the default back camera ahead of the framework.
+ *
+ * The first open() of the blob loads firmware and brings up the ISP, and
+ * nothing starts that before cameraserver asks. The power HAL sets
+ * vendor.camera.provider.prewarm on its CAMERA_LAUNCH hint, and the back
+ * camera is then opened in the background and kept for a short window.
+ * If the framework opens it meanwhile it gets the device already open,
+ * otherwise it is closed again once the window is over. Nothing is opened
+ * ahead while the framework has any camera open, and the camera opened
+ * ahead holds its OpenArbiter cost like any other.
+ *
+ * Only open() runs ahead, initialize() can't be repeated and is left to
+ * the framework with its own callbacks.
+ */
+class CameraPrewarmer {
+public:
+    static bool isEnabled();
+
+    /*
+     * Start watching the trigger, once the module is initialized. The back
+     * camera is looked up on the first trigger, open goes through
+     * vendorOpen. Only the first call counts.
+     */
+    static void start(camera_module_t *module,
+                      int (*vendorOpen)(const hw_module_t *module, const char *id,
+                                        hw_device_t **device));
+
+    /*
+     * The device opened ahead for an ID about to be opened, or NULL. It is
+     * handed over with its OpenArbiter cost still claimed. Only waits for
+     * an open still in progress of the same ID, one of another ID is
+     * closed once done, and a device already open closed right away, so
+     * the blob doesn't keep both. The ID counts as open until closed().
+     */
+    static hw_device_t *claim(int id);
+
+    /*
+     * Wait for a camera being opened or closed ahead to be done, and its
+     * cost to be given back if it is closed.
+     */
+    static void settle();
+
+    static void closed();
+};
+
+#endif // CAMERA_PREWARMER_H
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "CaptureRecorder"
+
+#include "CaptureRecorder.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include <cutils/properties.h>
+#include <log/log.h>
+
+#include "CaptureTrace.h"
+
+// Size of each capture trace in KiB, recording is off if 0.
+const char *kCaptureTraceSizeProp = "ro.vendor.camera.provider.capture_trace_kb";
+
+// Number of capture traces kept, the oldest ones are removed first.
+const char *kCaptureTraceCountProp = "ro.vendor.camera.provider.capture_trace_count";
+const int kCaptureTraceCountDefault = 4;
+
+const char *kCaptureTraceDir = "/data/vendor/camera";
+const char *kCaptureTracePrefix = "capture_";
+const char *kCaptureTraceSuffix = ".trace";
+
+/*
+ * Remove the oldest traces until there is room for another one.
+ */
+static void pruneTraces(size_t keep) {
+    DIR *dir = opendir(kCaptureTraceDir);
+    if (dir == nullptr) {
+        return;
+    }
+
+    std::vector<std::pair<int64_t, std::string>> traces;
+    size_t prefixLen = strlen(kCaptureTracePrefix), suffixLen = strlen(kCaptureTraceSuffix);
+    while (struct dirent *entry = readdir(dir)) {
+        size_t len = strlen(entry->d_name);
+        if (len < prefixLen + suffixLen ||
+                strncmp(entry->d_name, kCaptureTracePrefix, prefixLen) != 0 ||
+                strcmp(entry->d_name + len - suffixLen, kCaptureTraceSuffix) != 0) {
+            continue;
+        }
+
+        // Names restart with every boot, the modification time doesn't.
+        std::string path = std::string(kCaptureTraceDir) + "/" + entry->d_name;
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0) {
+            traces.emplace_back(st.st_mtime * 1000000000LL + st.st_mtim.tv_nsec, path);
+        }
+    }
+    closedir(dir);
+
+    std::sort(traces.begin(), traces.end());
+    for (size_t i = 0; i + keep <= traces.size(); i++) {
+        if (unlink(traces[i].second.c_str()) != 0) {
+            ALOGW("Failed to remove %s: %s", traces[i].second.c_str(), strerror(errno));
+        }
+    }
+}
+
+static uint32_t metadataSize(const camera_metadata_t *metadata) {
+    return metadata != nullptr ? captureTraceAlign(get_camera_metadata_compact_size(metadata)) : 0;
+}
+
+static uint8_t *writeMetadata(uint8_t *dst, uint32_t size, const camera_metadata_t *metadata) {
+    if (size > 0) {
+        copy_camera_metadata(dst, size, metadata);
+    }
+
+    return dst + size;
+}
+
+bool CaptureRecorder::isEnabled() {
+    static bool enabled = property_get_int32(kCaptureTraceSizeProp, 0) > 0;
+
+    return enabled;
+}
+
+std::unique_ptr<CaptureRecorder> CaptureRecorder::create(int cameraId,
+                                                         const camera_metadata_t *characteristics) {
+    size_t size = static_cast<size_t>(property_get_int32(kCaptureTraceSizeProp, 0)) * 1024;
+    if (size < sizeof(CaptureTraceHeader)) {
+        return nullptr;
+    }
+
+    int count = property_get_int32(kCaptureTraceCountProp, kCaptureTraceCountDefault);
+    pruneTraces(std::max(count, 1));
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s%d_%" PRId64 "%s", kCaptureTraceDir, kCaptureTracePrefix,
+             cameraId, systemTime(SYSTEM_TIME_BOOTTIME) / 1000000, kCaptureTraceSuffix);
+
+    int fd = TEMP_FAILURE_RETRY(open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0660));
+    if (fd < 0) {
+        ALOGW("Failed to create %s: %s", path, strerror(errno));
+        return nullptr;
+    }
+
+    // Allocated upfront, a sparse file would SIGBUS once the disk fills up.
+    int rc = posix_fallocate(fd, 0, size);
+    if (rc != 0) {
+        ALOGW("Failed to allocate %zu bytes for %s: %s", size, path, strerror(rc));
+        close(fd);
+        unlink(path);
+        return nullptr;
+    }
+
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        ALOGW("Failed to map %s: %s", path, strerror(errno));
+        close(fd);
+        unlink(path);
+        return nullptr;
+    }
+
+    auto *header = static_cast<CaptureTraceHeader *>(map);
+    header->magic = kCaptureTraceMagic;
+    header->version = kCaptureTraceVersion;
+    header->cameraId = cameraId;
+    header->reserved = 0;
+
+    std::unique_ptr<CaptureRecorder> recorder(
+            new CaptureRecorder(path, fd, static_cast<uint8_t *>(map), size));
+
+    // Replaying needs the partial result count and friends.
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    uint32_t characteristicsSize = metadataSize(characteristics);
+    uint32_t payloadSize = sizeof(CaptureTraceMetadata) + characteristicsSize;
+    uint8_t *payload = recorder->reserve(payloadSize);
+
+    if (payload != nullptr) {
+        auto *record = reinterpret_cast<CaptureTraceMetadata *>(payload);
+        record->metadataSize = characteristicsSize;
+        record->reserved = 0;
+        writeMetadata(payload + sizeof(*record), characteristicsSize, characteristics);
+        recorder->commit(payload, CAPTURE_RECORD_CHARACTERISTICS, payloadSize, now);
+    }
+
+    ALOGI("Recording camera %d to %s", cameraId, path);
+    return recorder;
+}
+
+CaptureRecorder::CaptureRecorder(const std::string& path, int fd, uint8_t *map, size_t size)
+    : mPath(path), mFd(fd), mMap(map), mSize(size), mOffset(sizeof(CaptureTraceHeader)),
+      mNumDropped(0) {}
+
+CaptureRecorder::~CaptureRecorder() {
+    size_t used = std::min(mOffset.load(), mSize);
+
+    munmap(mMap, mSize);
+    if (ftruncate(mFd, used) != 0) {
+        ALOGW("Failed to trim %s: %s", mPath.c_str(), strerror(errno));
+    }
+    close(mFd);
+
+    ALOGI("Recorded %zu bytes to %s, dropped %u records", used, mPath.c_str(),
+          mNumDropped.load());
+}
+
+void CaptureRecorder::configure(const camera3_stream_configuration_t *streamList) {
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    mStreams.assign(streamList->streams, streamList->streams + streamList->num_streams);
+
+    uint32_t payloadSize = sizeof(CaptureTraceConfigure) +
+            streamList->num_streams * sizeof(CaptureTraceStream);
+    uint8_t *payload = reserve(payloadSize);
+    if (payload == nullptr) {
+        return;
+    }
+
+    auto *record = reinterpret_cast<CaptureTraceConfigure *>(payload);
+    record->operationMode = streamList->operation_mode;
+    record->numStreams = streamList->num_streams;
+
+    auto *streams = reinterpret_cast<CaptureTraceStream *>(payload + sizeof(*record));
+    for (uint32_t i = 0; i < streamList->num_streams; i++) {
+        const camera3_stream_t *stream = streamList->streams[i];
+
+        streams[i] = {
+            .streamType = stream->stream_type,
+            .width = stream->width,
+            .height = stream->height,
+            .format = stream->format,
+            .usage = stream->usage,
+            .maxBuffers = stream->max_buffers,
+            .dataSpace = static_cast<int32_t>(stream->data_space),
+            .rotation = stream->rotation,
+            .reserved = 0,
+        };
+    }
+
+    commit(payload, CAPTURE_RECORD_CONFIGURE, payloadSize, now);
+}
+
+void CaptureRecorder::request(const camera3_capture_request_t *request) {
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    uint32_t settingsSize = metadataSize(request->settings);
+    uint32_t payloadSize = sizeof(CaptureTraceRequest) +
+            request->num_output_buffers * sizeof(CaptureTraceBuffer) + settingsSize;
+
+    uint8_t *payload = reserve(payloadSize);
+    if (payload == nullptr) {
+        return;
+    }
+
+    auto *record = reinterpret_cast<CaptureTraceRequest *>(payload);
+    record->frameNumber = request->frame_number;
+    record->inputStream = request->input_buffer ? streamIndex(request->input_buffer->stream) : -1;
+    record->numOutputBuffers = request->num_output_buffers;
+    record->settingsSize = settingsSize;
+
+    uint8_t *dst = writeBuffers(payload + sizeof(*record), request->output_buffers,
+                                request->num_output_buffers);
+    writeMetadata(dst, settingsSize, request->settings);
+
+    commit(payload, CAPTURE_RECORD_REQUEST, payloadSize, now);
+}
+
+void CaptureRecorder::notify(const camera3_notify_msg_t *msg) {
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    uint8_t *payload = reserve(sizeof(CaptureTraceNotify));
+    if (payload == nullptr) {
+        return;
+    }
+
+    auto *record = reinterpret_cast<CaptureTraceNotify *>(payload);
+    record->type = msg->type;
+    if (msg->type == CAMERA3_MSG_SHUTTER) {
+        record->frameNumber = msg->message.shutter.frame_number;
+        record->errorCode = 0;
+        record->errorStream = -1;
+        record->timestamp = msg->message.shutter.timestamp;
+    } else {
+        record->frameNumber = msg->message.error.frame_number;
+        record->errorCode = msg->message.error.error_code;
+        record->errorStream = streamIndex(msg->message.error.error_stream);
+        record->timestamp = 0;
+    }
+
+    commit(payload, CAPTURE_RECORD_NOTIFY, sizeof(CaptureTraceNotify), now);
+}
+
+void CaptureRecorder::result(const camera3_capture_result_t *result) {
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    uint32_t resultSize = metadataSize(result->result);
+    uint32_t payloadSize = sizeof(CaptureTraceResult) +
+            result->num_output_buffers * sizeof(CaptureTraceBuffer) + resultSize;
+
+    uint8_t *payload = reserve(payloadSize);
+    if (payload == nullptr) {
+        return;
+    }
+
+    auto *record = reinterpret_cast<CaptureTraceResult *>(payload);
+    record->frameNumber = result->frame_number;
+    record->partialResult = result->partial_result;
+    record->inputStream = result->input_buffer ? streamIndex(result->input_buffer->stream) : -1;
+    record->numOutputBuffers = result->num_output_buffers;
+    record->metadataSize = resultSize;
+    record->reserved = 0;
+
+    uint8_t *dst = writeBuffers(payload + sizeof(*record), result->output_buffers,
+                                result->num_output_buffers);
+    writeMetadata(dst, resultSize, result->result);
+
+    commit(payload, CAPTURE_RECORD_RESULT, payloadSize, now);
+}
+
+/*
+ * Claim room for a record, returning where its payload goes. The record
+ * header stays CAPTURE_RECORD_NONE until commit().
+ */
+uint8_t *CaptureRecorder::reserve(uint32_t payloadSize) {
+    size_t recordSize = sizeof(CaptureTraceRecord) + payloadSize;
+    size_t offset = mOffset.fetch_add(recordSize, std::memory_order_relaxed);
+
+    if (offset + recordSize > mSize) {
+        mNumDropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    return mMap + offset + sizeof(CaptureTraceRecord);
+}
+
+void CaptureRecorder::commit(uint8_t *payload, uint32_t type, uint32_t payloadSize,
+                             nsecs_t timestamp) {
+    auto *record = reinterpret_cast<CaptureTraceRecord *>(payload - sizeof(CaptureTraceRecord));
+
+    record->size = payloadSize;
+    record->timestampNs = timestamp;
+    __atomic_store_n(&record->type, type, __ATOMIC_RELEASE);
+}
+
+int32_t CaptureRecorder::streamIndex(const camera3_stream_t *stream) const {
+    auto it = std::find(mStreams.begin(), mStreams.end(), stream);
+
+    return it != mStreams.end() ? it - mStreams.begin() : -1;
+}
+
+uint8_t *CaptureRecorder::writeBuffers(uint8_t *dst, const camera3_stream_buffer_t *buffers,
+                                       uint32_t numBuffers) const {
+    auto *records = reinterpret_cast<CaptureTraceBuffer *>(dst);
+
+    for (uint32_t i = 0; i < numBuffers; i++) {
+        records[i].stream = streamIndex(buffers[i].stream);
+        records[i].status = buffers[i].status;
+    }
+
+    return dst + numBuffers * sizeof(CaptureTraceBuffer);
+}
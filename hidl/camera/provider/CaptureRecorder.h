@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAPTURE_RECORDER_H
+#define CAPTURE_RECORDER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <hardware/camera3.h>
+#include <utils/Timers.h>
+
+/*
+ * Records everything going through one camera3 device into a capture
+ * trace, see CaptureTrace.h.
+ *
+ * The trace is a fixed size file mapped into memory. Records are appended
+ * from any thread by reserving space with one atomic add, and are only
+ * marked valid once fully written. Once the file is full, further records
+ * are dropped.
+ *
+ * The whole file is allocated when recording starts, so a full disk fails
+ * create() rather than a write to the mapping later on. Only the newest
+ * few traces are kept.
+ */
+class CaptureRecorder {
+public:
+    static bool isEnabled();
+
+    /*
+     * Start a new trace in /data/vendor/camera, NULL if disabled or failed,
+     * e.g. because the disk is full.
+     */
+    static std::unique_ptr<CaptureRecorder> create(int cameraId,
+                                                   const camera_metadata_t *characteristics);
+
+    ~CaptureRecorder();
+
+    /*
+     * Only called on an idle device, the streams are looked up unlocked.
+     */
+    void configure(const camera3_stream_configuration_t *streamList);
+
+    void request(const camera3_capture_request_t *request);
+    void notify(const camera3_notify_msg_t *msg);
+    void result(const camera3_capture_result_t *result);
+
+private:
+    CaptureRecorder(const std::string& path, int fd, uint8_t *map, size_t size);
+
+    uint8_t *reserve(uint32_t payloadSize);
+    void commit(uint8_t *payload, uint32_t type, uint32_t payloadSize, nsecs_t timestamp);
+    int32_t streamIndex(const camera3_stream_t *stream) const;
+    uint8_t *writeBuffers(uint8_t *dst, const camera3_stream_buffer_t *buffers,
+                          uint32_t numBuffers) const;
+
+    std::string mPath;
+    int mFd;
+    uint8_t *mMap;
+    size_t mSize;
+    std::atomic<size_t> mOffset;
+    std::atomic<uint32_t> mNumDropped;
+    std::vector<const camera3_stream_t *> mStreams;
+};
+
+#endif // CAPTURE_RECORDER_H
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CAPTURE_TRACE_H
+#define CAPTURE_TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Layout of a capture trace, written by CaptureRecorder and read by the
+ * replay tool. All values are native endian.
+ *
+ * The file starts with a CaptureTraceHeader, followed by records until one
+ * has type CAPTURE_RECORD_NONE or the file ends. Each record is a
+ * CaptureTraceRecord and size bytes of payload, aligned to 8 bytes so the
+ * camera_metadata inside can be used in place.
+ *
+ * Streams are referred to by their index in the last configuration, -1
+ * means none. Metadata is a compact camera_metadata copy, its size is 0 if
+ * the pointer was NULL.
+ */
+
+const uint32_t kCaptureTraceMagic = 0x33636163; // "cac3"
+const uint32_t kCaptureTraceVersion = 1;
+const uint32_t kCaptureTraceAlignment = 8;
+
+enum CaptureRecordType : uint32_t {
+    CAPTURE_RECORD_NONE = 0,
+    // CaptureTraceMetadata, static characteristics of the camera.
+    CAPTURE_RECORD_CHARACTERISTICS,
+    // CaptureTraceConfigure, then CaptureTraceStream[numStreams].
+    CAPTURE_RECORD_CONFIGURE,
+    // CaptureTraceRequest, then CaptureTraceBuffer[numOutputBuffers], then settings.
+    CAPTURE_RECORD_REQUEST,
+    // CaptureTraceNotify.
+    CAPTURE_RECORD_NOTIFY,
+    // CaptureTraceResult, then CaptureTraceBuffer[numOutputBuffers], then metadata.
+    CAPTURE_RECORD_RESULT,
+};
+
+struct CaptureTraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t cameraId;
+    uint32_t reserved;
+};
+
+struct CaptureTraceRecord {
+    uint32_t type;
+    uint32_t size;
+    // Monotonic time the call reached the provider.
+    int64_t timestampNs;
+};
+
+struct CaptureTraceMetadata {
+    uint32_t metadataSize;
+    uint32_t reserved;
+};
+
+struct CaptureTraceConfigure {
+    uint32_t operationMode;
+    uint32_t numStreams;
+};
+
+struct CaptureTraceStream {
+    int32_t streamType;
+    uint32_t width;
+    uint32_t height;
+    int32_t format;
+    uint64_t usage;
+    uint32_t maxBuffers;
+    int32_t dataSpace;
+    int32_t rotation;
+    uint32_t reserved;
+};
+
+struct CaptureTraceBuffer {
+    int32_t stream;
+    int32_t status;
+};
+
+struct CaptureTraceRequest {
+    uint32_t frameNumber;
+    int32_t inputStream;
+    uint32_t numOutputBuffers;
+    uint32_t settingsSize;
+};
+
+struct CaptureTraceNotify {
+    int32_t type;
+    uint32_t frameNumber;
+    int32_t errorCode;
+    int32_t errorStream;
+    uint64_t timestamp;
+};
+
+struct CaptureTraceResult {
+    uint32_t frameNumber;
+    uint32_t partialResult;
+    int32_t inputStream;
+    uint32_t numOutputBuffers;
+    uint32_t metadataSize;
+    uint32_t reserved;
+};
+
+static inline uint32_t captureTraceAlign(uint32_t size) {
+    return (size + kCaptureTraceAlignment - 1) & ~(kCaptureTraceAlignment - 1);
+}
+
+#endif // CAPTURE_TRACE_H
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ExtraIDs"
+
+#include "ExtraIDs.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include <log/log.h>
+
+void parseExtraIDs(const char *value, std::vector<int> *ids, std::vector<int> *lazyIds) {
+    std::string copy(value);
+
+    char *saveptr;
+    for (char *entry = strtok_r(copy.data(), ",", &saveptr); entry != nullptr;
+            entry = strtok_r(nullptr, ",", &saveptr)) {
+        char *end;
+        long id = strtol(entry, &end, 10);
+
+        if (end == entry || id < 0 || id > INT_MAX || (*end != '\0' && *end != ':')) {
+            ALOGE("Ignoring malformed extra camera ID \"%s\"", entry);
+            continue;
+        }
+
+        if (*end == '\0') {
+            ids->push_back(id);
+        } else if (strcmp(end + 1, "lazy") == 0) {
+            lazyIds->push_back(id);
+        } else {
+            ALOGE("Ignoring extra camera ID \"%s\" with unknown suffix", entry);
+        }
+    }
+}
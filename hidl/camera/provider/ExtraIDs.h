@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXTRA_IDS_H
+#define EXTRA_IDS_H
+
+#include <vector>
+
+/*
+ * Parse a comma separated list of extra camera IDs, each optionally
+ * suffixed with ":lazy", into ids and lazyIds. Malformed entries, and
+ * entries with any other suffix, are logged and skipped.
+ */
+void parseExtraIDs(const char *value, std::vector<int> *ids, std::vector<int> *lazyIds);
+
+#endif // EXTRA_IDS_H
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "FlushWatchdog"
+
+#include "FlushWatchdog.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <cutils/properties.h>
+#include <log/log.h>
+
+// Fail the frames still in flight once flush() has taken this long, 0 is off.
+const char *kFlushTimeoutProp = "ro.vendor.camera.provider.flush_timeout_ms";
+
+// Vendor flush durations kept for dump().
+const size_t kMaxDurations = 64;
+
+bool FlushWatchdog::isEnabled() {
+    static bool enabled = property_get_int32(kFlushTimeoutProp, 0) > 0;
+
+    return enabled;
+}
+
+FlushWatchdog::FlushWatchdog(camera3_device_t *vendorDevice)
+    : mVendorDevice(vendorDevice),
+      mTimeoutNs(ms2ns(property_get_int32(kFlushTimeoutProp, 0))),
+      mStop(false),
+      mPending(false),
+      mRunning(false),
+      mResult(0),
+      mStartNs(0),
+      mAbandonedFrameNumber(-1),
+      mDetached(false),
+      mNumTimeouts(0),
+      mNumDropped(0) {
+    mThread = std::thread(&FlushWatchdog::run, this);
+}
+
+FlushWatchdog::~FlushWatchdog() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStop = true;
+    }
+    mCondition.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+bool FlushWatchdog::flush(int *rc) {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    if (!mRunning) {
+        mPending = true;
+        mRunning = true;
+        mStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        mCondition.notify_all();
+    }
+
+    if (!mCondition.wait_until(lock, std::chrono::steady_clock::now() +
+                                             std::chrono::nanoseconds(mTimeoutNs),
+                               [this] { return !mRunning; })) {
+        mNumTimeouts++;
+        ALOGW("Vendor flush still running after %" PRId64 "ms",
+              ns2ms(systemTime(SYSTEM_TIME_MONOTONIC) - mStartNs));
+        return false;
+    }
+
+    *rc = mResult;
+    return true;
+}
+
+void FlushWatchdog::waitForVendor() {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    mCondition.wait(lock, [this] { return !mRunning; });
+}
+
+bool FlushWatchdog::detach(const std::function<void()>& close) {
+    std::unique_lock<std::shared_mutex> gate(mGate);
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (!mRunning) {
+        return false;
+    }
+
+    ALOGW("Closing with the vendor flush running for %" PRId64 "ms, closing the vendor "
+          "device once it returns", ns2ms(systemTime(SYSTEM_TIME_MONOTONIC) - mStartNs));
+    mDetached = true;
+    mClose = close;
+    return true;
+}
+
+void FlushWatchdog::abandon(uint32_t frameNumber, const std::function<void()>& fail) {
+    std::unique_lock<std::shared_mutex> lock(mGate);
+
+    mAbandonedFrameNumber = std::max<int64_t>(mAbandonedFrameNumber, frameNumber);
+    fail();
+}
+
+bool FlushWatchdog::enter(uint32_t frameNumber) {
+    mGate.lock_shared();
+
+    if (mDetached || static_cast<int64_t>(frameNumber) <= mAbandonedFrameNumber) {
+        mGate.unlock_shared();
+        mNumDropped++;
+        return false;
+    }
+
+    return true;
+}
+
+void FlushWatchdog::leave() {
+    mGate.unlock_shared();
+}
+
+bool FlushWatchdog::enterAny() {
+    mGate.lock_shared();
+
+    if (mDetached) {
+        mGate.unlock_shared();
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<nsecs_t> FlushWatchdog::vendorDurations() {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    return mDurations;
+}
+
+void FlushWatchdog::dump(int fd) {
+    nsecs_t runningNs = 0;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mRunning) {
+            runningNs = systemTime(SYSTEM_TIME_MONOTONIC) - mStartNs;
+        }
+    }
+
+    dprintf(fd, "  Flush watchdog: %" PRId64 "ms deadline, %u missed, "
+            "%u late callbacks of failed frames\n",
+            ns2ms(mTimeoutNs), mNumTimeouts.load(), mNumDropped.load());
+    if (runningNs > 0) {
+        dprintf(fd, "    Vendor flush running for %.2fms\n", runningNs / 1e6);
+    }
+}
+
+void FlushWatchdog::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    while (true) {
+        mCondition.wait(lock, [this] { return mStop || mPending; });
+        // A flush asked for before closing still runs.
+        if (!mPending) {
+            break;
+        }
+        mPending = false;
+
+        lock.unlock();
+        int rc = mVendorDevice->ops->flush(mVendorDevice);
+        lock.lock();
+
+        nsecs_t duration = systemTime(SYSTEM_TIME_MONOTONIC) - mStartNs;
+        if (duration > mTimeoutNs) {
+            ALOGW("Vendor flush returned %d after %" PRId64 "ms", rc, ns2ms(duration));
+        }
+
+        if (mDurations.size() >= kMaxDurations) {
+            mDurations.erase(mDurations.begin());
+        }
+        mDurations.push_back(duration);
+        mResult = rc;
+        mRunning = false;
+
+        if (mClose) {
+            std::function<void()> close = std::move(mClose);
+
+            // close() deletes us, so nobody may join this thread any more.
+            mThread.detach();
+            lock.unlock();
+            close();
+            return;
+        }
+
+        mCondition.notify_all();
+    }
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLUSH_WATCHDOG_H
+#define FLUSH_WATCHDOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <hardware/camera3.h>
+#include <utils/Timers.h>
+
+/*
+ * Bounds how long flush() keeps the framework waiting.
+ *
+ * camera3 gives flush() a second, the blob sometimes takes several and
+ * closing the app hangs on it. The vendor flush runs on a thread of its
+ * own, and once the deadline passes flush() returns without it. The frames
+ * still in flight are then abandoned: the device fails them towards the
+ * framework itself, and of whatever the blob sends for them later only the
+ * buffers are passed on. Until the vendor flush returns, nothing else may
+ * reach the blob: the next configure_streams() and process_capture_request()
+ * still wait for it. close() doesn't, the device is detached instead and
+ * the vendor device closed once its flush returns, with nothing of it
+ * reaching the framework in between.
+ *
+ * Callbacks of the blob go through enter() and leave(), so none of an
+ * abandoned frame is half way through when the device fails it. Frame
+ * numbers only go up, everything up to the last abandoned one stays
+ * abandoned.
+ */
+class FlushWatchdog {
+public:
+    static bool isEnabled();
+
+    explicit FlushWatchdog(camera3_device_t *vendorDevice);
+
+    /*
+     * Waits for a vendor flush still running, unless detached.
+     */
+    ~FlushWatchdog();
+
+    /*
+     * Flush the vendor device, waiting at most until the deadline. Returns
+     * whether it finished, rc is only set if so. A flush still running from
+     * last time is waited on instead of starting another.
+     */
+    bool flush(int *rc);
+
+    /*
+     * Wait for a vendor flush still running past the deadline.
+     */
+    void waitForVendor();
+
+    /*
+     * Close without waiting for a vendor flush still running past the
+     * deadline: no callback of the blob goes through from now on, and once
+     * the vendor flush returns, close is called on the watchdog's thread and
+     * must delete the watchdog. Returns false, changing nothing, if no vendor
+     * flush is running.
+     */
+    bool detach(const std::function<void()>& close);
+
+    /*
+     * Abandon every frame up to frameNumber, once no callback of theirs is
+     * in progress, and fail them before any can start again.
+     */
+    void abandon(uint32_t frameNumber, const std::function<void()>& fail);
+
+    /*
+     * Whether a callback of the blob for a frame may go through, it must
+     * then leave() once done.
+     */
+    bool enter(uint32_t frameNumber);
+    void leave();
+
+    /*
+     * Like enter(), for what goes through even for abandoned frames, only
+     * held off once detached.
+     */
+    bool enterAny();
+
+    /*
+     * How long the vendor flushes took, oldest first.
+     */
+    std::vector<nsecs_t> vendorDurations();
+
+    void dump(int fd);
+
+private:
+    void run();
+
+    camera3_device_t *mVendorDevice;
+    nsecs_t mTimeoutNs;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    bool mStop;
+    bool mPending;
+    bool mRunning;
+    int mResult;
+    nsecs_t mStartNs;
+    std::vector<nsecs_t> mDurations;
+    std::function<void()> mClose;
+    std::thread mThread;
+
+    // Held shared by callbacks going through, exclusively to abandon frames.
+    std::shared_mutex mGate;
+    int64_t mAbandonedFrameNumber;
+    bool mDetached;
+
+    std::atomic<uint32_t> mNumTimeouts;
+    std::atomic<uint32_t> mNumDropped;
+};
+
+#endif // FLUSH_WATCHDOG_H
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_CAMERA
+
+#include "FrameTracer.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include <cutils/trace.h>
+
+FrameTracer::FrameTracer(int cameraId)
+    : mCameraId(cameraId),
+      mFrameTrack("cam" + std::to_string(cameraId) + " frames"),
+      mShutterTrack("cam" + std::to_string(cameraId) + " shutter"),
+      mEventTrack("cam" + std::to_string(cameraId) + " results"),
+      mInflightCounter("cam" + std::to_string(cameraId) + " requests in flight") {}
+
+void FrameTracer::configure(const camera3_stream_configuration_t *streamList) {
+    std::lock_guard<std::mutex> lock(mStreamsLock);
+
+    // Configuring requires an idle device, nothing carries over.
+    mStreams.clear();
+    for (uint32_t i = 0; i < streamList->num_streams; i++) {
+        const camera3_stream_t *stream = streamList->streams[i];
+        char name[64];
+
+        snprintf(name, sizeof(name), "cam%d stream %u %ux%u/0x%x buffers", mCameraId, i,
+                 stream->width, stream->height, stream->format);
+        mStreams[stream] = {name, 0};
+    }
+}
+
+void FrameTracer::request(const camera3_capture_request_t *request, size_t numInflight) {
+    if (!ATRACE_ENABLED()) {
+        return;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "frame %u", request->frame_number);
+
+    ATRACE_ASYNC_FOR_TRACK_BEGIN(mFrameTrack.c_str(), name, request->frame_number);
+    ATRACE_ASYNC_FOR_TRACK_BEGIN(mShutterTrack.c_str(), name, request->frame_number);
+    ATRACE_INT(mInflightCounter.c_str(), numInflight);
+
+    countBuffers(request->output_buffers, request->num_output_buffers, 1);
+    if (request->input_buffer != nullptr) {
+        countBuffers(request->input_buffer, 1, 1);
+    }
+}
+
+void FrameTracer::shutter(uint32_t frameNumber) {
+    if (!ATRACE_ENABLED()) {
+        return;
+    }
+
+    ATRACE_ASYNC_FOR_TRACK_END(mShutterTrack.c_str(), frameNumber);
+}
+
+void FrameTracer::result(const camera3_capture_result_t *result) {
+    if (!ATRACE_ENABLED()) {
+        return;
+    }
+
+    char name[64];
+
+    if (result->partial_result > 0) {
+        snprintf(name, sizeof(name), "frame %u partial %u", result->frame_number,
+                 result->partial_result);
+        ATRACE_INSTANT_FOR_TRACK(mEventTrack.c_str(), name);
+    }
+
+    for (uint32_t i = 0; i < result->num_output_buffers; i++) {
+        const camera3_stream_t *stream = result->output_buffers[i].stream;
+
+        snprintf(name, sizeof(name), "frame %u buffer %ux%u/0x%x%s", result->frame_number,
+                 stream->width, stream->height, stream->format,
+                 result->output_buffers[i].status == CAMERA3_BUFFER_STATUS_ERROR ? " error" : "");
+        ATRACE_INSTANT_FOR_TRACK(mEventTrack.c_str(), name);
+    }
+
+    countBuffers(result->output_buffers, result->num_output_buffers, -1);
+    if (result->input_buffer != nullptr) {
+        countBuffers(result->input_buffer, 1, -1);
+    }
+}
+
+void FrameTracer::error(const camera3_error_msg_t *error) {
+    if (!ATRACE_ENABLED()) {
+        return;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "frame %u error %d", error->frame_number, error->error_code);
+    ATRACE_INSTANT_FOR_TRACK(mEventTrack.c_str(), name);
+
+    // A failed request never gets its shutter.
+    if (error->error_code == CAMERA3_MSG_ERROR_REQUEST) {
+        ATRACE_ASYNC_FOR_TRACK_END(mShutterTrack.c_str(), error->frame_number);
+    }
+}
+
+void FrameTracer::complete(uint32_t frameNumber, size_t numInflight) {
+    if (!ATRACE_ENABLED()) {
+        return;
+    }
+
+    ATRACE_ASYNC_FOR_TRACK_END(mFrameTrack.c_str(), frameNumber);
+    ATRACE_INT(mInflightCounter.c_str(), numInflight);
+}
+
+/*
+ * Only counts while tracing, so a count may start off wrong if tracing got
+ * enabled mid-session. It never goes below zero and resets on configure.
+ */
+void FrameTracer::countBuffers(const camera3_stream_buffer_t *buffers, uint32_t numBuffers,
+                               int32_t delta) {
+    std::lock_guard<std::mutex> lock(mStreamsLock);
+
+    for (uint32_t i = 0; i < numBuffers; i++) {
+        auto it = mStreams.find(buffers[i].stream);
+        if (it == mStreams.end()) {
+            continue;
+        }
+
+        it->second.numBuffers = std::max(it->second.numBuffers + delta, 0);
+        ATRACE_INT(it->second.name.c_str(), it->second.numBuffers);
+    }
+}
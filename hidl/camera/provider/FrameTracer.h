@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAME_TRACER_H
+#define FRAME_TRACER_H
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <hardware/camera3.h>
+
+/*
+ * Emits the lifecycle of every frame of one camera to atrace/perfetto.
+ *
+ * Per camera there is an async track of whole frames, request to last
+ * buffer, one of request to shutter slices and one of instant events for
+ * every partial result and returned buffer. Counters follow the requests
+ * in flight and the buffers in flight of each configured stream.
+ *
+ * Every per-frame call is a single check of the enabled atrace tags while
+ * the camera category isn't traced.
+ */
+class FrameTracer {
+public:
+    explicit FrameTracer(int cameraId);
+
+    void configure(const camera3_stream_configuration_t *streamList);
+    void request(const camera3_capture_request_t *request, size_t numInflight);
+    void shutter(uint32_t frameNumber);
+    void result(const camera3_capture_result_t *result);
+    void error(const camera3_error_msg_t *error);
+    void complete(uint32_t frameNumber, size_t numInflight);
+
+private:
+    struct StreamCounter {
+        std::string name;
+        int32_t numBuffers;
+    };
+
+    void countBuffers(const camera3_stream_buffer_t *buffers, uint32_t numBuffers, int32_t delta);
+
+    int mCameraId;
+    std::string mFrameTrack;
+    std::string mShutterTrack;
+    std::string mEventTrack;
+    std::string mInflightCounter;
+
+    std::mutex mStreamsLock;
+    std::map<const camera3_stream_t *, StreamCounter> mStreams;
+};
+
+#endif // FRAME_TRACER_H
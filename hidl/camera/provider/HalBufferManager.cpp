@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "HalBufferManager"
+
+#include "HalBufferManager.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include <cutils/properties.h>
+#include <log/log.h>
+#include <utils/Timers.h>
+
+// Advertise HAL buffer management and fetch buffers for the blob ourselves.
+const char *kHalBufferManagementProp = "ro.vendor.camera.provider.hal_buffer_management";
+
+// How long a request waits for a stream to get a buffer back before it fails.
+// It holds up the request thread of the blob meanwhile, and the longest wait
+// that succeeded is in the dump to tune it by.
+const char *kFetchTimeoutProp = "ro.vendor.camera.provider.hal_buffer_fetch_timeout_ms";
+const int kFetchTimeoutMsDefault = 200;
+
+static bool isEmpty(const camera3_stream_buffer_t& buffer) {
+    return buffer.buffer == nullptr || *buffer.buffer == nullptr;
+}
+
+bool HalBufferManager::isEnabled() {
+    static bool enabled = property_get_bool(kHalBufferManagementProp, false);
+
+    return enabled;
+}
+
+camera_metadata_t *HalBufferManager::advertise(const camera_metadata_t *characteristics) {
+    camera_metadata_ro_entry_t entry;
+
+    if (find_camera_metadata_ro_entry(characteristics,
+                                      ANDROID_INFO_SUPPORTED_BUFFER_MANAGEMENT_VERSION,
+                                      &entry) == 0) {
+        return nullptr;
+    }
+
+    camera_metadata_t *advertised = allocate_camera_metadata(
+            get_camera_metadata_entry_count(characteristics) + 1,
+            get_camera_metadata_data_count(characteristics));
+    uint8_t version = ANDROID_INFO_SUPPORTED_BUFFER_MANAGEMENT_VERSION_HIDL_DEVICE_3_5;
+
+    if (advertised == nullptr || append_camera_metadata(advertised, characteristics) != 0 ||
+            add_camera_metadata_entry(advertised, ANDROID_INFO_SUPPORTED_BUFFER_MANAGEMENT_VERSION,
+                                      &version, 1) != 0) {
+        ALOGE("Failed to advertise HAL buffer management");
+        free_camera_metadata(advertised);
+        return nullptr;
+    }
+
+    return advertised;
+}
+
+HalBufferManager::HalBufferManager()
+    : mCallbacks(nullptr),
+      mReturnCount(0),
+      mFlushCount(0),
+      mFetchTimeoutNs(ms2ns(property_get_int32(kFetchTimeoutProp, kFetchTimeoutMsDefault))),
+      mLongestWaitNs(0),
+      mNumFetched(0),
+      mNumWaits(0),
+      mNumTimeouts(0),
+      mNumFailed(0) {}
+
+void HalBufferManager::initialize(const camera3_callback_ops_t *callbacks) {
+    mCallbacks = callbacks->request_stream_buffers != nullptr ? callbacks : nullptr;
+}
+
+HalBufferManager::Result HalBufferManager::fetch(const camera3_capture_request_t *request,
+                                                 std::vector<camera3_stream_buffer_t> *buffers) {
+    buffers->assign(request->output_buffers,
+                    request->output_buffers + request->num_output_buffers);
+
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < buffers->size(); i++) {
+        if (isEmpty((*buffers)[i])) {
+            pending.push_back(i);
+        }
+    }
+
+    if (pending.empty()) {
+        return FETCHED;
+    }
+    if (mCallbacks == nullptr) {
+        ALOGE("Request %u came without buffers", request->frame_number);
+        return REQUEST_ERROR;
+    }
+
+    std::vector<camera3_buffer_request_t> bufferReqs;
+    std::vector<camera3_stream_buffer_ret_t> returnedBufReqs;
+    std::vector<camera3_stream_buffer_t> returnedBuffers(pending.size());
+    nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t deadlineNs = startNs + mFetchTimeoutNs;
+    bool waited = false;
+    uint64_t flushCount;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        flushCount = mFlushCount;
+    }
+
+    while (true) {
+        uint64_t returnCount;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            returnCount = mReturnCount;
+        }
+
+        // One buffer request per stream still missing buffers, usually one each.
+        bufferReqs.clear();
+        for (size_t i : pending) {
+            camera3_stream_t *stream = (*buffers)[i].stream;
+            auto it = std::find_if(bufferReqs.begin(), bufferReqs.end(),
+                                   [&](const camera3_buffer_request_t& req) {
+                                       return req.stream == stream;
+                                   });
+
+            if (it == bufferReqs.end()) {
+                bufferReqs.push_back({stream, 1});
+            } else {
+                it->num_buffers_requested++;
+            }
+        }
+
+        returnedBufReqs.resize(bufferReqs.size());
+        camera3_stream_buffer_t *storage = returnedBuffers.data();
+        for (size_t i = 0; i < bufferReqs.size(); i++) {
+            returnedBufReqs[i].output_buffers = storage;
+            storage += bufferReqs[i].num_buffers_requested;
+        }
+
+        uint32_t numReturned = 0;
+        camera3_buffer_request_status_t status = mCallbacks->request_stream_buffers(
+                mCallbacks, bufferReqs.size(), bufferReqs.data(), &numReturned,
+                returnedBufReqs.data());
+        if (status == CAMERA3_BUF_REQ_FAILED_CONFIGURING ||
+                status == CAMERA3_BUF_REQ_FAILED_ILLEGAL_ARGUMENTS) {
+            mNumFailed++;
+            return REQUEST_ERROR;
+        }
+
+        bool retry = false;
+        for (uint32_t i = 0; i < numReturned && i < returnedBufReqs.size(); i++) {
+            const camera3_stream_buffer_ret_t& ret = returnedBufReqs[i];
+
+            if (ret.status == CAMERA3_PS_BUF_REQ_UNKNOWN_ERROR) {
+                mNumFailed++;
+                return DEVICE_ERROR;
+            }
+            if (ret.status == CAMERA3_PS_BUF_REQ_STREAM_DISCONNECTED) {
+                mNumFailed++;
+                return REQUEST_ERROR;
+            }
+            if (ret.status != CAMERA3_PS_BUF_REQ_OK) {
+                retry = true;
+                continue;
+            }
+
+            uint32_t next = 0;
+            for (auto it = pending.begin(); it != pending.end() && next < ret.num_output_buffers;) {
+                camera3_stream_buffer_t& buffer = (*buffers)[*it];
+
+                if (buffer.stream != ret.stream) {
+                    ++it;
+                    continue;
+                }
+
+                buffer = ret.output_buffers[next++];
+                buffer.status = CAMERA3_BUFFER_STATUS_OK;
+                buffer.release_fence = -1;
+                mNumFetched++;
+                it = pending.erase(it);
+            }
+        }
+
+        if (pending.empty()) {
+            if (waited) {
+                std::lock_guard<std::mutex> lock(mLock);
+                mLongestWaitNs =
+                        std::max(mLongestWaitNs, systemTime(SYSTEM_TIME_MONOTONIC) - startNs);
+            }
+            return FETCHED;
+        }
+        if (!retry) {
+            mNumFailed++;
+            return REQUEST_ERROR;
+        }
+
+        // Some stream has all of its buffers out, wait for the blob to return one.
+        mNumWaits++;
+        waited = true;
+        std::unique_lock<std::mutex> lock(mLock);
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (now >= deadlineNs ||
+                !mCondition.wait_for(lock, std::chrono::nanoseconds(deadlineNs - now), [&] {
+                    return mReturnCount != returnCount || mFlushCount != flushCount;
+                })) {
+            ALOGW("Request %u got no buffer back within %" PRId64 "ms", request->frame_number,
+                  ns2ms(mFetchTimeoutNs));
+            mNumTimeouts++;
+            mNumFailed++;
+            return REQUEST_ERROR;
+        }
+        if (mFlushCount != flushCount) {
+            mNumFailed++;
+            return REQUEST_ERROR;
+        }
+    }
+}
+
+void HalBufferManager::giveBack(const camera3_capture_request_t *request,
+                                std::vector<camera3_stream_buffer_t>& buffers) {
+    std::vector<const camera3_stream_buffer_t *> fetched;
+
+    // Buffers that came with the request stay the framework's, it knows the request failed.
+    for (size_t i = 0; i < buffers.size() && i < request->num_output_buffers; i++) {
+        if (isEmpty(request->output_buffers[i]) && !isEmpty(buffers[i])) {
+            buffers[i].status = CAMERA3_BUFFER_STATUS_ERROR;
+            buffers[i].release_fence = buffers[i].acquire_fence;
+            buffers[i].acquire_fence = -1;
+            fetched.push_back(&buffers[i]);
+        }
+    }
+
+    if (fetched.empty() || mCallbacks->return_stream_buffers == nullptr) {
+        return;
+    }
+
+    mCallbacks->return_stream_buffers(mCallbacks, fetched.size(), fetched.data());
+    returned(fetched.size());
+}
+
+void HalBufferManager::returned(uint32_t numBuffers) {
+    if (mCallbacks == nullptr || numBuffers == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mReturnCount++;
+    }
+    mCondition.notify_all();
+}
+
+void HalBufferManager::flush() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mFlushCount++;
+    }
+    mCondition.notify_all();
+}
+
+void HalBufferManager::dump(int fd) {
+    nsecs_t longestWaitNs;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        longestWaitNs = mLongestWaitNs;
+    }
+
+    dprintf(fd, "  HAL buffer management: %s, %" PRIu64 " buffers fetched, %" PRIu64
+            " failed requests\n", mCallbacks != nullptr ? "on" : "off", mNumFetched.load(),
+            mNumFailed.load());
+    dprintf(fd, "    Waits: %" PRIu64 ", longest fetch %.2fms, %" PRIu64 " timed out after %"
+            PRId64 "ms\n", mNumWaits.load(), longestWaitNs / 1e6, mNumTimeouts.load(),
+            ns2ms(mFetchTimeoutNs));
+}
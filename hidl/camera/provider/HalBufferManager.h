@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HAL_BUFFER_MANAGER_H
+#define HAL_BUFFER_MANAGER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <hardware/camera3.h>
+#include <utils/Timers.h>
+
+/*
+ * Lets the framework manage buffers the way it does for HALs supporting
+ * HAL buffer management, on top of a blob that doesn't.
+ *
+ * The camera advertises HIDL_DEVICE_3_5 buffer management, so requests come
+ * in without buffers and the framework only allocates what is actually in
+ * use instead of a full pipeline of buffers per stream. Right before a
+ * request is handed to the blob, its buffers are fetched through
+ * request_stream_buffers(), waiting for one to come back if a stream has
+ * all of its buffers out. The blob still sees complete requests. Devices
+ * older than 3.5 aren't offered it, their session can't ask for buffers.
+ */
+class HalBufferManager {
+public:
+    enum Result {
+        FETCHED,
+        // The request has to fail with ERROR_REQUEST.
+        REQUEST_ERROR,
+        // The device has to fail with ERROR_DEVICE.
+        DEVICE_ERROR,
+    };
+
+    static bool isEnabled();
+
+    /*
+     * A copy of the characteristics advertising buffer management, which
+     * the caller owns, or NULL if they already do.
+     */
+    static camera_metadata_t *advertise(const camera_metadata_t *characteristics);
+
+    HalBufferManager();
+
+    /*
+     * Buffers are only fetched if the framework took up the offer.
+     */
+    void initialize(const camera3_callback_ops_t *callbacks);
+
+    /*
+     * Copy the output buffers of the request into buffers, fetching the
+     * ones the framework left empty. On failure, buffers that couldn't be
+     * fetched are left empty.
+     */
+    Result fetch(const camera3_capture_request_t *request,
+                 std::vector<camera3_stream_buffer_t> *buffers);
+
+    /*
+     * Hand buffers fetched for a request the blob rejected back through
+     * return_stream_buffers(), buffers as filled in by fetch().
+     */
+    void giveBack(const camera3_capture_request_t *request,
+                  std::vector<camera3_stream_buffer_t>& buffers);
+
+    /*
+     * Buffers went back to the framework, fetches waiting for one retry.
+     */
+    void returned(uint32_t numBuffers);
+
+    /*
+     * Fail fetches that are waiting, the framework wants its buffers back.
+     */
+    void flush();
+
+    void dump(int fd);
+
+private:
+    const camera3_callback_ops_t *mCallbacks;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    uint64_t mReturnCount;
+    uint64_t mFlushCount;
+    const nsecs_t mFetchTimeoutNs;
+    // Of the fetches that had to wait and got their buffers.
+    nsecs_t mLongestWaitNs;
+
+    std::atomic<uint64_t> mNumFetched;
+    std::atomic<uint64_t> mNumWaits;
+    std::atomic<uint64_t> mNumTimeouts;
+    std::atomic<uint64_t> mNumFailed;
+};
+
+#endif // HAL_BUFFER_MANAGER_H
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INFLIGHT_RING_H
+#define INFLIGHT_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+/*
+ * State of each frame in flight, looked up by frame number.
+ *
+ * Frame numbers only go up and a device only has so many frames in flight,
+ * so frame_number % depth picks a slot of a fixed ring and lookups never
+ * search. Results of a frame may come in any order, and frames may finish
+ * out of order, a slot is only free once its frame is erased. A frame
+ * whose slot is still taken, because more than depth frames are in
+ * flight, goes to an overflow map instead.
+ *
+ * Slots are reused as they are, so whatever a T allocated for one frame is
+ * still there for the next. insert() leaves it to the caller to set every
+ * field. Not thread safe.
+ */
+template <typename T>
+class InflightRing {
+public:
+    /*
+     * The depth is rounded up to a power of two.
+     */
+    explicit InflightRing(uint32_t depth) : mMask(0), mSize(0), mNumOverflowed(0) {
+        uint32_t capacity = 1;
+        while (capacity < depth) {
+            capacity <<= 1;
+        }
+
+        mSlots.resize(capacity);
+        mMask = capacity - 1;
+    }
+
+    /*
+     * The entry of a new frame, or the existing one if already there.
+     */
+    T *insert(uint32_t frameNumber) {
+        Slot& slot = mSlots[frameNumber & mMask];
+
+        if (!slot.used) {
+            slot.used = true;
+            slot.frameNumber = frameNumber;
+            mSize++;
+            return &slot.value;
+        }
+        if (slot.frameNumber == frameNumber) {
+            return &slot.value;
+        }
+
+        auto [it, inserted] = mOverflow.try_emplace(frameNumber);
+        if (inserted) {
+            mSize++;
+            mNumOverflowed++;
+        }
+        return &it->second;
+    }
+
+    T *find(uint32_t frameNumber) {
+        Slot& slot = mSlots[frameNumber & mMask];
+
+        if (slot.used && slot.frameNumber == frameNumber) {
+            return &slot.value;
+        }
+        if (!mOverflow.empty()) {
+            auto it = mOverflow.find(frameNumber);
+            if (it != mOverflow.end()) {
+                return &it->second;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void erase(uint32_t frameNumber) {
+        Slot& slot = mSlots[frameNumber & mMask];
+
+        if (slot.used && slot.frameNumber == frameNumber) {
+            slot.used = false;
+            mSize--;
+        } else if (mOverflow.erase(frameNumber) > 0) {
+            mSize--;
+        }
+    }
+
+    void clear() {
+        for (Slot& slot : mSlots) {
+            slot.used = false;
+        }
+        mOverflow.clear();
+        mSize = 0;
+    }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+    size_t capacity() const { return mSlots.size(); }
+
+    /*
+     * How many frames didn't find their slot free.
+     */
+    uint64_t numOverflowed() const { return mNumOverflowed; }
+
+    /*
+     * Every frame in flight in frame number order, this one does search.
+     */
+    std::vector<uint32_t> frameNumbers() const {
+        std::vector<uint32_t> frameNumbers;
+
+        for (const Slot& slot : mSlots) {
+            if (slot.used) {
+                frameNumbers.push_back(slot.frameNumber);
+            }
+        }
+        for (const auto& [frameNumber, value] : mOverflow) {
+            frameNumbers.push_back(frameNumber);
+        }
+
+        std::sort(frameNumbers.begin(), frameNumbers.end());
+        return frameNumbers;
+    }
+
+private:
+    // One cache line each at least, so neighbouring frames don't share one.
+    struct alignas(64) Slot {
+        uint32_t frameNumber = 0;
+        bool used = false;
+        T value;
+    };
+
+    std::vector<Slot> mSlots;
+    uint32_t mMask;
+    size_t mSize;
+    uint64_t mNumOverflowed;
+    std::map<uint32_t, T> mOverflow;
+};
+
+#endif // INFLIGHT_RING_H
@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "JpegSizeTracker"
+
+#include "JpegSizeTracker.h"
+
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <cutils/properties.h>
+#include <linux/dma-buf.h>
+#include <log/log.h>
+#include <system/graphics.h>
+
+// Read the size of every JPEG coming back and keep them for dump().
+const char *kJpegSizesProp = "ro.vendor.camera.provider.jpeg_sizes";
+/*
+ * Comma separated "ID:bytes", advertised as android.jpeg.maxSize if lower.
+ * The framework sizes every JPEG buffer from it, and a JPEG that doesn't
+ * fit is cut off by the blob or fails the capture. Only set it well above
+ * the largest JPEG seen at the highest quality, in the dark and with the
+ * most detailed scenes. JPEGs coming close to their buffer are logged as
+ * errors and counted in dump(), keep an eye on those after lowering it.
+ */
+const char *kJpegMaxSizeProp = "ro.vendor.camera.provider.jpeg_max_size";
+
+// Sizes kept per resolution and quality for the percentiles.
+const size_t kMaxRecentSizes = 256;
+
+// Frames waiting for their JPEG, the oldest are given up on past this.
+const size_t kMaxPendingFrames = 64;
+
+// How far back from the end a header that isn't there is looked for.
+const size_t kMaxHeaderScan = 64 * 1024;
+
+// Added on top of the largest JPEG seen for the max size suggested by dump().
+const uint32_t kHeadroomPercent = 25;
+
+// A JPEG taking more of its buffer than this is close to not fitting.
+const uint32_t kNearMaxPercent = 90;
+
+static bool isJpeg(const camera3_stream_t *stream) {
+    return stream->format == HAL_PIXEL_FORMAT_BLOB &&
+            (stream->data_space == HAL_DATASPACE_V0_JFIF ||
+             stream->data_space == HAL_DATASPACE_JFIF);
+}
+
+bool JpegSizeTracker::isEnabled() {
+    static bool enabled = property_get_bool(kJpegSizesProp, false);
+
+    return enabled;
+}
+
+camera_metadata_t *JpegSizeTracker::advertise(int id, const camera_metadata_t *characteristics) {
+    char value[PROPERTY_VALUE_MAX];
+    property_get(kJpegMaxSizeProp, value, "");
+
+    int32_t maxSize = 0;
+    char *saveptr;
+    for (char *entry = strtok_r(value, ",", &saveptr); entry != nullptr;
+            entry = strtok_r(nullptr, ",", &saveptr)) {
+        int entryId, entrySize;
+
+        if (sscanf(entry, "%d:%d", &entryId, &entrySize) == 2 && entryId == id) {
+            maxSize = entrySize;
+        }
+    }
+
+    camera_metadata_ro_entry_t entry;
+    if (maxSize <= 0 ||
+            find_camera_metadata_ro_entry(characteristics, ANDROID_JPEG_MAX_SIZE, &entry) != 0 ||
+            entry.count != 1 || maxSize >= entry.data.i32[0]) {
+        return nullptr;
+    }
+
+    camera_metadata_t *advertised = clone_camera_metadata(characteristics);
+    if (advertised == nullptr ||
+            update_camera_metadata_entry(advertised, entry.index, &maxSize, 1, nullptr) != 0) {
+        ALOGE("Failed to advertise a JPEG max size of %d for ID=%d", maxSize, id);
+        free_camera_metadata(advertised);
+        return nullptr;
+    }
+
+    ALOGI("Advertising a JPEG max size of %d instead of %d for ID=%d", maxSize,
+          entry.data.i32[0], id);
+    return advertised;
+}
+
+/*
+ * The header found by scanning has to point back at a whole JPEG, from SOI
+ * to EOI, entropy coded data is full of 0xFF 0x00.
+ */
+static bool isValidHeader(const camera3_jpeg_blob_t& blob, const uint8_t *data, size_t offset,
+                          bool checkMarkers) {
+    if (blob.jpeg_blob_id != CAMERA3_JPEG_BLOB_ID || blob.jpeg_size < 4 ||
+            blob.jpeg_size > offset) {
+        return false;
+    }
+
+    return !checkMarkers ||
+            (data[0] == 0xFF && data[1] == 0xD8 && data[blob.jpeg_size - 2] == 0xFF &&
+             data[blob.jpeg_size - 1] == 0xD9);
+}
+
+JpegSizeTracker::Header JpegSizeTracker::findHeader(const uint8_t *data, size_t size,
+                                                    uint32_t *jpegSize) {
+    camera3_jpeg_blob_t blob;
+
+    if (size < sizeof(blob)) {
+        return MISSING;
+    }
+
+    size_t offset = size - sizeof(blob);
+    memcpy(&blob, data + offset, sizeof(blob));
+    if (isValidHeader(blob, data, offset, false)) {
+        *jpegSize = blob.jpeg_size;
+        return AT_END;
+    }
+
+    // The ID starts with 0xFF, and memrchr() skips everything else a word at a time.
+    size_t start = offset > kMaxHeaderScan ? offset - kMaxHeaderScan : 0;
+    while (offset > start) {
+        const void *found = memrchr(data + start, 0xFF, offset - start);
+        if (found == nullptr) {
+            break;
+        }
+
+        offset = static_cast<const uint8_t *>(found) - data;
+        memcpy(&blob, data + offset, sizeof(blob));
+        if (isValidHeader(blob, data, offset, true)) {
+            *jpegSize = blob.jpeg_size;
+            return MOVED;
+        }
+    }
+
+    return MISSING;
+}
+
+JpegSizeTracker::JpegSizeTracker(int id)
+    : mId(id), mQuality(-1), mNumAtEnd(0), mNumMoved(0), mNumMissing(0), mNumSkipped(0),
+      mNumNearMax(0) {}
+
+void JpegSizeTracker::configure(const camera3_stream_configuration_t *streamList) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mStreams.clear();
+    mPending.clear();
+    for (uint32_t i = 0; i < streamList->num_streams; i++) {
+        if (isJpeg(streamList->streams[i])) {
+            mStreams.push_back(streamList->streams[i]);
+        }
+    }
+}
+
+void JpegSizeTracker::request(const camera3_capture_request_t *request) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    camera_metadata_ro_entry_t entry;
+    if (request->settings != nullptr &&
+            find_camera_metadata_ro_entry(request->settings, ANDROID_JPEG_QUALITY, &entry) == 0 &&
+            entry.count == 1) {
+        mQuality = entry.data.u8[0];
+    }
+
+    uint32_t numBuffers = 0;
+    for (uint32_t i = 0; i < request->num_output_buffers; i++) {
+        if (std::find(mStreams.begin(), mStreams.end(), request->output_buffers[i].stream) !=
+                mStreams.end()) {
+            numBuffers++;
+        }
+    }
+    if (numBuffers == 0) {
+        return;
+    }
+
+    if (mPending.size() >= kMaxPendingFrames) {
+        mPending.erase(mPending.begin());
+    }
+    mPending[request->frame_number] = {mQuality, numBuffers};
+}
+
+void JpegSizeTracker::cancel(uint32_t frameNumber) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mPending.erase(frameNumber);
+}
+
+/*
+ * Map the buffer just long enough to read its header. The blob may still
+ * be writing it as long as its release fence is up, those are skipped
+ * rather than held up.
+ */
+bool JpegSizeTracker::read(const camera3_stream_buffer_t& buffer, uint32_t *jpegSize,
+                           size_t *bufferSize) {
+    if (buffer.buffer == nullptr || *buffer.buffer == nullptr || (*buffer.buffer)->numFds < 1) {
+        return false;
+    }
+
+    if (buffer.release_fence >= 0) {
+        struct pollfd fence = {.fd = buffer.release_fence, .events = POLLIN, .revents = 0};
+        if (poll(&fence, 1, 0) != 1) {
+            return false;
+        }
+    }
+
+    int fd = (*buffer.buffer)->data[0];
+    off_t size = lseek(fd, 0, SEEK_END);
+    lseek(fd, 0, SEEK_SET);
+    if (size <= 0) {
+        return false;
+    }
+
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    // Written by the JPEG encoder, the CPU cache may not have seen it yet.
+    struct dma_buf_sync sync = {.flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ};
+    ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+
+    Header header = findHeader(static_cast<const uint8_t *>(data), size, jpegSize);
+
+    sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ;
+    ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+    munmap(data, size);
+
+    switch (header) {
+        case AT_END:
+            mNumAtEnd++;
+            break;
+        case MOVED:
+            mNumMoved++;
+            break;
+        case MISSING:
+            mNumMissing++;
+            return false;
+    }
+
+    *bufferSize = size;
+    return true;
+}
+
+void JpegSizeTracker::result(const camera3_capture_result_t *result) {
+    for (uint32_t i = 0; i < result->num_output_buffers; i++) {
+        const camera3_stream_buffer_t& buffer = result->output_buffers[i];
+        int32_t quality;
+
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+
+            if (std::find(mStreams.begin(), mStreams.end(), buffer.stream) == mStreams.end()) {
+                continue;
+            }
+
+            auto it = mPending.find(result->frame_number);
+            if (it == mPending.end()) {
+                continue;
+            }
+            quality = it->second.quality;
+            if (--it->second.numBuffers == 0) {
+                mPending.erase(it);
+            }
+        }
+
+        // Failed captures have nothing to read.
+        if (buffer.status != CAMERA3_BUFFER_STATUS_OK) {
+            continue;
+        }
+
+        uint32_t jpegSize;
+        size_t bufferSize;
+        if (!read(buffer, &jpegSize, &bufferSize)) {
+            mNumSkipped++;
+            continue;
+        }
+
+        // The framework sized the buffer from the advertised max size.
+        size_t used = jpegSize + sizeof(camera3_jpeg_blob_t);
+        if (used > bufferSize / 100 * kNearMaxPercent) {
+            mNumNearMax++;
+            ALOGE("ID=%d: %ux%u JPEG of frame %u takes %zu of its %zu bytes, raise %s if set",
+                  mId, buffer.stream->width, buffer.stream->height, result->frame_number, used,
+                  bufferSize, kJpegMaxSizeProp);
+        }
+
+        std::lock_guard<std::mutex> lock(mLock);
+        Sizes& sizes = mSizes[Key(buffer.stream->width, buffer.stream->height, quality)];
+
+        if (sizes.recent.size() < kMaxRecentSizes) {
+            sizes.recent.push_back(jpegSize);
+        } else {
+            sizes.recent[sizes.next] = jpegSize;
+            sizes.next = (sizes.next + 1) % kMaxRecentSizes;
+        }
+        sizes.count++;
+        sizes.max = std::max(sizes.max, jpegSize);
+        sizes.maxBufferSize = std::max(sizes.maxBufferSize, bufferSize);
+    }
+}
+
+void JpegSizeTracker::dump(int fd) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    dprintf(fd, "  JPEG headers: %" PRIu64 " at the end, %" PRIu64 " moved, %" PRIu64
+            " missing, %" PRIu64 " buffers skipped\n",
+            mNumAtEnd.load(), mNumMoved.load(), mNumMissing.load(), mNumSkipped.load());
+    dprintf(fd, "  JPEGs taking over %u%% of their buffer: %" PRIu64 "\n", kNearMaxPercent,
+            mNumNearMax.load());
+
+    uint64_t largestArea = 0;
+    uint32_t largestMax = 0;
+    for (const auto& [key, sizes] : mSizes) {
+        const auto& [width, height, quality] = key;
+        std::vector<uint32_t> sorted = sizes.recent;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto percentile = [&sorted](int p) { return sorted[(sorted.size() - 1) * p / 100] / 1024; };
+        dprintf(fd, "    %ux%u q%d: n=%" PRIu64 " p50=%uKiB p90=%uKiB p99=%uKiB max=%uKiB"
+                " buffer=%zuKiB\n",
+                width, height, quality, sizes.count, percentile(50), percentile(90),
+                percentile(99), sizes.max / 1024, sizes.maxBufferSize / 1024);
+
+        uint64_t area = static_cast<uint64_t>(width) * height;
+        if (area > largestArea) {
+            largestArea = area;
+            largestMax = 0;
+        }
+        if (area == largestArea) {
+            largestMax = std::max(largestMax, sizes.max);
+        }
+    }
+
+    // The framework scales the max size down for smaller resolutions itself.
+    if (largestMax > 0) {
+        dprintf(fd, "    Every JPEG so far would fit %s=%d:%zu\n", kJpegMaxSizeProp, mId,
+                largestMax + largestMax / 100 * kHeadroomPercent + sizeof(camera3_jpeg_blob_t));
+    }
+}
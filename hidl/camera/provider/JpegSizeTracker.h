@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef JPEG_SIZE_TRACKER_H
+#define JPEG_SIZE_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <hardware/camera3.h>
+
+/*
+ * Keeps the sizes of the JPEGs the blob actually produces.
+ *
+ * Every JPEG buffer is allocated for android.jpeg.maxSize, the worst case
+ * the blob advertises, while the JPEG itself ends where the camera3_jpeg_blob
+ * header at the end of the buffer says. The header of every JPEG coming
+ * back is read, and the sizes are kept per resolution and quality for
+ * dump(), along with a max size that would have fit them all.
+ *
+ * A tighter max size can then be advertised per ID, so the framework
+ * allocates smaller buffers, which adds up quickly in burst capture. That
+ * only works if the blob places the header by the size of the buffer it is
+ * given, which the header counts in dump() tell. A JPEG that comes close
+ * to filling its buffer is logged as an error and counted, since a
+ * slightly larger one would no longer fit.
+ */
+class JpegSizeTracker {
+public:
+    enum Header {
+        // Where it is supposed to be, in the last bytes of the buffer.
+        AT_END,
+        // Somewhere before, e.g. when gralloc rounded the buffer up.
+        MOVED,
+        MISSING,
+    };
+
+    static bool isEnabled();
+
+    /*
+     * A copy of the characteristics advertising the max size configured
+     * for the ID, which the caller owns, or NULL if there is none or it
+     * isn't any tighter.
+     */
+    static camera_metadata_t *advertise(int id, const camera_metadata_t *characteristics);
+
+    /*
+     * Find the header in a mapped JPEG buffer, and the size of the JPEG
+     * it carries.
+     */
+    static Header findHeader(const uint8_t *data, size_t size, uint32_t *jpegSize);
+
+    explicit JpegSizeTracker(int id);
+
+    void configure(const camera3_stream_configuration_t *streamList);
+
+    void request(const camera3_capture_request_t *request);
+    void cancel(uint32_t frameNumber);
+
+    /*
+     * Read the size of JPEG buffers, before they go back to the framework.
+     */
+    void result(const camera3_capture_result_t *result);
+
+    void dump(int fd);
+
+private:
+    struct PendingFrame {
+        int32_t quality;
+        uint32_t numBuffers;
+    };
+
+    struct Sizes {
+        // The last sizes, in the order they came in once full.
+        std::vector<uint32_t> recent;
+        size_t next;
+        uint64_t count;
+        uint32_t max;
+        size_t maxBufferSize;
+    };
+
+    // Width, height and quality.
+    using Key = std::tuple<uint32_t, uint32_t, int32_t>;
+
+    bool read(const camera3_stream_buffer_t& buffer, uint32_t *jpegSize, size_t *bufferSize);
+
+    int mId;
+
+    std::mutex mLock;
+    // JPEG streams of the current configuration.
+    std::vector<const camera3_stream_t *> mStreams;
+    // Settings may be NULL, meaning the same quality as last time.
+    int32_t mQuality;
+    std::map<uint32_t, PendingFrame> mPending;
+    std::map<Key, Sizes> mSizes;
+
+    std::atomic<uint64_t> mNumAtEnd;
+    std::atomic<uint64_t> mNumMoved;
+    std::atomic<uint64_t> mNumMissing;
+    std::atomic<uint64_t> mNumSkipped;
+    std::atomic<uint64_t> mNumNearMax;
+};
+
+#endif // JPEG_SIZE_TRACKER_H
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LatencyRing.h"
+
+LatencyRing::LatencyRing() : mHead(0) {
+    for (auto& slot : mSlots) {
+        slot.seq.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyRing::push(const FrameLatency& latency) {
+    uint64_t pos = mHead.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = mSlots[pos % kCapacity];
+
+    // Record n is published as 2n + 2, readers ignore anything else.
+    slot.seq.store(2 * pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.frameNumber.store(latency.frameNumber, std::memory_order_relaxed);
+    slot.configId.store(latency.configId, std::memory_order_relaxed);
+    slot.shutterNs.store(latency.shutterNs, std::memory_order_relaxed);
+    slot.partialResultNs.store(latency.partialResultNs, std::memory_order_relaxed);
+    slot.finalResultNs.store(latency.finalResultNs, std::memory_order_relaxed);
+    slot.completeNs.store(latency.completeNs, std::memory_order_relaxed);
+    slot.failed.store(latency.failed, std::memory_order_relaxed);
+
+    slot.seq.store(2 * pos + 2, std::memory_order_release);
+}
+
+std::vector<FrameLatency> LatencyRing::snapshot() const {
+    uint64_t head = mHead.load(std::memory_order_acquire);
+    uint64_t start = head > kCapacity ? head - kCapacity : 0;
+    std::vector<FrameLatency> latencies;
+
+    latencies.reserve(head - start);
+
+    for (uint64_t pos = start; pos < head; pos++) {
+        const Slot& slot = mSlots[pos % kCapacity];
+        uint64_t seq = slot.seq.load(std::memory_order_acquire);
+
+        if (seq != 2 * pos + 2) {
+            continue;
+        }
+
+        FrameLatency latency;
+        latency.frameNumber = slot.frameNumber.load(std::memory_order_relaxed);
+        latency.configId = slot.configId.load(std::memory_order_relaxed);
+        latency.shutterNs = slot.shutterNs.load(std::memory_order_relaxed);
+        latency.partialResultNs = slot.partialResultNs.load(std::memory_order_relaxed);
+        latency.finalResultNs = slot.finalResultNs.load(std::memory_order_relaxed);
+        latency.completeNs = slot.completeNs.load(std::memory_order_relaxed);
+        latency.failed = slot.failed.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == seq) {
+            latencies.push_back(latency);
+        }
+    }
+
+    return latencies;
+}
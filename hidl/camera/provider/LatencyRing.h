@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATENCY_RING_H
+#define LATENCY_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include <utils/Timers.h>
+
+/*
+ * Latencies of one completed frame, relative to process_capture_request().
+ * A stage that never happened, e.g. the shutter of a failed request, is -1.
+ */
+struct FrameLatency {
+    uint32_t frameNumber;
+    uint32_t configId;
+    nsecs_t shutterNs;
+    nsecs_t partialResultNs;
+    nsecs_t finalResultNs;
+    nsecs_t completeNs;
+    bool failed;
+};
+
+/*
+ * Fixed size ring of the most recent FrameLatency records.
+ *
+ * Any number of threads may push() without taking a lock. Each slot carries
+ * a sequence number that is odd while it is being written, so snapshot()
+ * can skip records that change under it instead of blocking the writers.
+ */
+class LatencyRing {
+public:
+    static constexpr size_t kCapacity = 1024;
+
+    LatencyRing();
+
+    void push(const FrameLatency& latency);
+
+    /*
+     * Copy out the records currently held, oldest first.
+     */
+    std::vector<FrameLatency> snapshot() const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        std::atomic<uint32_t> frameNumber;
+        std::atomic<uint32_t> configId;
+        std::atomic<int64_t> shutterNs;
+        std::atomic<int64_t> partialResultNs;
+        std::atomic<int64_t> finalResultNs;
+        std::atomic<int64_t> completeNs;
+        std::atomic<bool> failed;
+    };
+
+    std::atomic<uint64_t> mHead;
+    Slot mSlots[kCapacity];
+};
+
+#endif // LATENCY_RING_H
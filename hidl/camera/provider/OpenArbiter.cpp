@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "OpenArbiter"
+
+#include "OpenArbiter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <cutils/properties.h>
+#include <log/log.h>
+
+// Comma separated "ID:cost", open cameras may cost 100 at most together.
+const char *kResourceCostsProp = "ro.vendor.camera.provider.resource_costs";
+
+// Same budget as cameraserver works with.
+const int kMaxResourceCost = 100;
+
+struct Conflicts {
+    std::vector<std::string> ids;
+    std::vector<char *> names;
+};
+
+struct OpenStats {
+    uint32_t numOpened;
+    uint32_t numRefused;
+    uint32_t numInitialized;
+    nsecs_t lastOpenNs;
+    nsecs_t maxOpenNs;
+    nsecs_t totalOpenNs;
+    nsecs_t lastInitializeNs;
+    nsecs_t maxInitializeNs;
+    nsecs_t totalInitializeNs;
+};
+
+static std::mutex sLock;
+static bool sCostsLoaded;
+static std::map<int, int> sCosts;
+// Handed out through camera_info, never freed.
+static std::map<int, Conflicts> sConflicts;
+static std::map<int, int> sOpenCosts;
+static std::map<int, OpenStats> sStats;
+
+static void loadCostsLocked() {
+    if (sCostsLoaded) {
+        return;
+    }
+    sCostsLoaded = true;
+
+    char value[PROPERTY_VALUE_MAX];
+    property_get(kResourceCostsProp, value, "");
+
+    char *saveptr;
+    for (char *entry = strtok_r(value, ",", &saveptr); entry != nullptr;
+            entry = strtok_r(nullptr, ",", &saveptr)) {
+        int id, cost;
+
+        if (sscanf(entry, "%d:%d", &id, &cost) != 2 || id < 0 || cost < 0 ||
+                cost > kMaxResourceCost) {
+            ALOGE("Ignoring malformed resource cost \"%s\"", entry);
+            continue;
+        }
+
+        sCosts[id] = cost;
+    }
+}
+
+bool OpenArbiter::isEnabled() {
+    static bool enabled = [] {
+        char value[PROPERTY_VALUE_MAX];
+        return property_get(kResourceCostsProp, value, "") > 0;
+    }();
+
+    return enabled;
+}
+
+/*
+ * The vendor conflicts are kept, the ones our costs add are appended.
+ */
+void OpenArbiter::advertise(int id, struct camera_info *info) {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    loadCostsLocked();
+    auto cost = sCosts.find(id);
+    if (cost == sCosts.end()) {
+        return;
+    }
+
+    auto it = sConflicts.find(id);
+    if (it == sConflicts.end()) {
+        Conflicts& conflicts = sConflicts[id];
+
+        for (size_t i = 0; i < info->conflicting_devices_length; i++) {
+            conflicts.ids.push_back(info->conflicting_devices[i]);
+        }
+        for (const auto& [otherId, otherCost] : sCosts) {
+            std::string name = std::to_string(otherId);
+
+            if (otherId != id && cost->second + otherCost > kMaxResourceCost &&
+                    std::find(conflicts.ids.begin(), conflicts.ids.end(), name) ==
+                            conflicts.ids.end()) {
+                conflicts.ids.push_back(name);
+            }
+        }
+        for (std::string& name : conflicts.ids) {
+            conflicts.names.push_back(&name[0]);
+        }
+
+        it = sConflicts.find(id);
+    }
+
+    info->resource_cost = cost->second;
+    info->conflicting_devices = it->second.names.data();
+    info->conflicting_devices_length = it->second.names.size();
+}
+
+bool OpenArbiter::acquire(int id) {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    loadCostsLocked();
+    auto cost = sCosts.find(id);
+    if (cost == sCosts.end()) {
+        return true;
+    }
+
+    int total = cost->second;
+    for (const auto& [openId, openCost] : sOpenCosts) {
+        total += openCost;
+    }
+
+    if (total > kMaxResourceCost) {
+        ALOGW("Refusing to open ID=%d, would cost %d with %zu cameras open", id, total,
+              sOpenCosts.size());
+        sStats[id].numRefused++;
+        return false;
+    }
+
+    sOpenCosts[id] = cost->second;
+    return true;
+}
+
+void OpenArbiter::release(int id) {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    sOpenCosts.erase(id);
+}
+
+void OpenArbiter::opened(int id, nsecs_t durationNs) {
+    std::lock_guard<std::mutex> lock(sLock);
+    OpenStats& stats = sStats[id];
+
+    stats.numOpened++;
+    stats.lastOpenNs = durationNs;
+    stats.maxOpenNs = std::max(stats.maxOpenNs, durationNs);
+    stats.totalOpenNs += durationNs;
+
+    ALOGI("Opened ID=%d in %.2fms", id, durationNs / 1e6);
+}
+
+void OpenArbiter::initialized(int id, nsecs_t durationNs) {
+    std::lock_guard<std::mutex> lock(sLock);
+    OpenStats& stats = sStats[id];
+
+    stats.numInitialized++;
+    stats.lastInitializeNs = durationNs;
+    stats.maxInitializeNs = std::max(stats.maxInitializeNs, durationNs);
+    stats.totalInitializeNs += durationNs;
+}
+
+void OpenArbiter::dump(int fd) {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    dprintf(fd, "  Camera opens:\n");
+    for (const auto& [id, stats] : sStats) {
+        auto it = sCosts.find(id);
+        char cost[32] = "no cost";
+
+        if (it != sCosts.end()) {
+            snprintf(cost, sizeof(cost), "cost %d%s", it->second,
+                     sOpenCosts.count(id) > 0 ? ", open" : "");
+        }
+
+        dprintf(fd, "    ID=%d: %s, %u opened, %u refused\n", id, cost, stats.numOpened,
+                stats.numRefused);
+        if (stats.numOpened > 0) {
+            dprintf(fd, "      open: last %.2fms, avg %.2fms, max %.2fms\n",
+                    stats.lastOpenNs / 1e6,
+                    static_cast<double>(stats.totalOpenNs) / stats.numOpened / 1e6,
+                    stats.maxOpenNs / 1e6);
+        }
+        if (stats.numInitialized > 0) {
+            dprintf(fd, "      initialize: last %.2fms, avg %.2fms, max %.2fms\n",
+                    stats.lastInitializeNs / 1e6,
+                    static_cast<double>(stats.totalInitializeNs) / stats.numInitialized / 1e6,
+                    stats.maxInitializeNs / 1e6);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPEN_ARBITER_H
+#define OPEN_ARBITER_H
+
+#include <hardware/camera_common.h>
+#include <utils/Timers.h>
+
+/*
+ * Decides which cameras may be open at once, and keeps how long opening
+ * each one took.
+ *
+ * Multi-camera apps open the extra IDs right after the main one, and the
+ * blob only fails a combination it can't run once streams get configured.
+ * Each ID can be given a resource cost, like camera_info.resource_cost, and
+ * cameras may only be open together while their costs add up to 100 at
+ * most. The costs and the IDs they rule out are advertised in camera_info,
+ * so cameraserver refuses or evicts up front, and an open that still goes
+ * over is refused with -EUSERS before reaching the blob. IDs without a
+ * cost are left alone.
+ *
+ * Nothing here runs opens in parallel, cameraserver decides that. Opening
+ * just takes no lock shared between IDs beyond the short one claiming the
+ * cost, so opens of independent IDs coming in at once don't wait on each
+ * other.
+ */
+class OpenArbiter {
+public:
+    static bool isEnabled();
+
+    /*
+     * Replace the resource cost and conflicting devices of an ID with ours.
+     */
+    static void advertise(int id, struct camera_info *info);
+
+    /*
+     * Claim the cost of an ID about to be opened, false if over budget.
+     * Must be released once closed or if opening fails.
+     */
+    static bool acquire(int id);
+    static void release(int id);
+
+    static void opened(int id, nsecs_t durationNs);
+    static void initialized(int id, nsecs_t durationNs);
+
+    static void dump(int fd);
+};
+
+#endif // OPEN_ARBITER_H
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ProviderStats"
+
+#include "ProviderStats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <cutils/properties.h>
+
+// Wrap opened devices so debug() counts their frames too.
+const char *kStatsProp = "ro.vendor.camera.provider.stats";
+
+// IDs from here on aren't counted, the extra IDs stay well below.
+const int kMaxIds = 64;
+
+struct alignas(64) ThreadCounters {
+    std::atomic<uint64_t> counts[kMaxIds][ProviderStats::NUM_COUNTERS];
+    std::atomic<int64_t> totalNs[kMaxIds][ProviderStats::NUM_TIMED];
+    std::atomic<int64_t> maxNs[kMaxIds][ProviderStats::NUM_TIMED];
+    // Whether a thread still counts into it.
+    bool inUse;
+};
+
+/*
+ * Gives the block back once its thread exits.
+ */
+struct ThreadSlot {
+    ThreadCounters *counters = nullptr;
+
+    ~ThreadSlot();
+};
+
+static std::mutex sLock;
+// Never freed, handed from exited threads to new ones.
+static std::vector<ThreadCounters *> sThreads;
+// Exposed IDs in the order they were added, and whether they are extra.
+static std::vector<std::pair<int, bool>> sExposed;
+static nsecs_t sLastDumpNs = systemTime(SYSTEM_TIME_MONOTONIC);
+static uint64_t sLastRequests[kMaxIds];
+
+static thread_local ThreadSlot tSlot;
+
+ThreadSlot::~ThreadSlot() {
+    if (counters != nullptr) {
+        std::lock_guard<std::mutex> lock(sLock);
+        counters->inUse = false;
+    }
+}
+
+static ThreadCounters *threadCounters() {
+    if (tSlot.counters != nullptr) {
+        return tSlot.counters;
+    }
+
+    std::lock_guard<std::mutex> lock(sLock);
+    auto it = std::find_if(sThreads.begin(), sThreads.end(),
+                           [](const ThreadCounters *c) { return !c->inUse; });
+    if (it == sThreads.end()) {
+        it = sThreads.insert(sThreads.end(), new ThreadCounters());
+    }
+
+    (*it)->inUse = true;
+    tSlot.counters = *it;
+    return tSlot.counters;
+}
+
+/*
+ * Only the owning thread writes, so there is no need for an atomic
+ * read-modify-write, the atomics only keep dump() from reading torn values.
+ */
+template <typename T>
+static void add(std::atomic<T>& counter, T value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+bool ProviderStats::isEnabled() {
+    static bool enabled = property_get_bool(kStatsProp, false);
+
+    return enabled;
+}
+
+void ProviderStats::exposed(int id, bool extra) {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    sExposed.emplace_back(id, extra);
+}
+
+void ProviderStats::count(int id, Counter counter) {
+    if (id < 0 || id >= kMaxIds) {
+        return;
+    }
+
+    add<uint64_t>(threadCounters()->counts[id][counter], 1);
+}
+
+void ProviderStats::time(int id, Counter counter, nsecs_t durationNs) {
+    if (id < 0 || id >= kMaxIds) {
+        return;
+    }
+
+    ThreadCounters *counters = threadCounters();
+    add<uint64_t>(counters->counts[id][counter], 1);
+    add<int64_t>(counters->totalNs[id][counter], durationNs);
+    if (durationNs > counters->maxNs[id][counter].load(std::memory_order_relaxed)) {
+        counters->maxNs[id][counter].store(durationNs, std::memory_order_relaxed);
+    }
+}
+
+void ProviderStats::error(int id, const camera3_error_msg_t *error) {
+    switch (error->error_code) {
+        case CAMERA3_MSG_ERROR_DEVICE:
+            count(id, ERROR_DEVICE);
+            break;
+        case CAMERA3_MSG_ERROR_REQUEST:
+            count(id, ERROR_REQUEST);
+            break;
+        case CAMERA3_MSG_ERROR_RESULT:
+            count(id, ERROR_RESULT);
+            break;
+        case CAMERA3_MSG_ERROR_BUFFER:
+            count(id, ERROR_BUFFER);
+            break;
+    }
+}
+
+void ProviderStats::dump(int fd) {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    static uint64_t counts[kMaxIds][NUM_COUNTERS];
+    static int64_t totalNs[kMaxIds][NUM_TIMED], maxNs[kMaxIds][NUM_TIMED];
+    std::fill(&counts[0][0], &counts[0][0] + kMaxIds * NUM_COUNTERS, 0);
+    std::fill(&totalNs[0][0], &totalNs[0][0] + kMaxIds * NUM_TIMED, 0);
+    std::fill(&maxNs[0][0], &maxNs[0][0] + kMaxIds * NUM_TIMED, 0);
+
+    for (const ThreadCounters *counters : sThreads) {
+        for (int id = 0; id < kMaxIds; id++) {
+            for (int i = 0; i < NUM_COUNTERS; i++) {
+                counts[id][i] += counters->counts[id][i].load(std::memory_order_relaxed);
+            }
+            for (int i = 0; i < NUM_TIMED; i++) {
+                totalNs[id][i] += counters->totalNs[id][i].load(std::memory_order_relaxed);
+                maxNs[id][i] = std::max(maxNs[id][i],
+                                        counters->maxNs[id][i].load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+    // Exposed IDs first, then whatever was only probed or opened.
+    std::vector<std::pair<int, const char *>> ids;
+    for (const auto& [id, extra] : sExposed) {
+        ids.emplace_back(id, extra ? " (extra)" : "");
+    }
+    for (int id = 0; id < kMaxIds; id++) {
+        if (std::find_if(ids.begin(), ids.end(), [id](const auto& e) { return e.first == id; }) ==
+                        ids.end() &&
+                std::any_of(counts[id], counts[id] + NUM_COUNTERS, [](uint64_t n) { return n > 0; })) {
+            ids.emplace_back(id, " (not exposed)");
+        }
+    }
+
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    double elapsed = (now - sLastDumpNs) / 1e9;
+    static const char *kTimedNames[NUM_TIMED] = {"probe", "open", "configure_streams"};
+
+    dprintf(fd, "Samsung camera provider, counted on %zu threads, %.1fs since the last dump:\n",
+            sThreads.size(), elapsed);
+    for (const auto& [id, kind] : ids) {
+        if (id < 0 || id >= kMaxIds) {
+            dprintf(fd, "  ID=%d%s: not counted\n", id, kind);
+            continue;
+        }
+
+        dprintf(fd, "  ID=%d%s:\n", id, kind);
+        for (int i = 0; i < NUM_TIMED; i++) {
+            if (counts[id][i] == 0) {
+                dprintf(fd, "    %s: none%s\n", kTimedNames[i],
+                        i == PROBE ? ", served from the store" : "");
+                continue;
+            }
+
+            dprintf(fd, "    %s: n=%" PRIu64 " avg=%.2fms max=%.2fms\n", kTimedNames[i],
+                    counts[id][i], static_cast<double>(totalNs[id][i]) / counts[id][i] / 1e6,
+                    maxNs[id][i] / 1e6);
+        }
+
+        uint64_t requests = counts[id][REQUEST];
+        dprintf(fd, "    requests: %" PRIu64 ", %.1f/s, %" PRIu64 " dropped frames\n", requests,
+                elapsed > 0 ? (requests - sLastRequests[id]) / elapsed : 0.0,
+                counts[id][DROPPED_FRAME]);
+        dprintf(fd, "    errors: device %" PRIu64 ", request %" PRIu64 ", result %" PRIu64
+                ", buffer %" PRIu64 "\n",
+                counts[id][ERROR_DEVICE], counts[id][ERROR_REQUEST], counts[id][ERROR_RESULT],
+                counts[id][ERROR_BUFFER]);
+    }
+
+    sLastDumpNs = now;
+    for (int id = 0; id < kMaxIds; id++) {
+        sLastRequests[id] = counts[id][REQUEST];
+    }
+}
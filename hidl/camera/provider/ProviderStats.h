@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROVIDER_STATS_H
+#define PROVIDER_STATS_H
+
+#include <hardware/camera3.h>
+#include <utils/Timers.h>
+
+/*
+ * Counters per camera ID for the provider's debug(), e.g. through
+ * lshal debug android.hardware.camera.provider@2.5::ICameraProvider/legacy/0
+ *
+ * Every thread counts into a block of its own, and blocks are only summed
+ * up when dumped, so counting takes neither a lock nor a cache line another
+ * thread writes to. A block outlives its thread and is handed to the next
+ * one, so nothing counted is lost.
+ *
+ * Probes and opens are counted whenever the module is hooked, the frame
+ * counters only for wrapped devices.
+ */
+class ProviderStats {
+public:
+    enum Counter {
+        // Timed, getCameraInfo() asking the blob rather than the cache.
+        PROBE,
+        OPEN,
+        CONFIGURE,
+        NUM_TIMED,
+
+        REQUEST = NUM_TIMED,
+        // Frames that completed with an error of any kind.
+        DROPPED_FRAME,
+        ERROR_DEVICE,
+        ERROR_REQUEST,
+        ERROR_RESULT,
+        ERROR_BUFFER,
+        NUM_COUNTERS,
+    };
+
+    /*
+     * Whether opened devices should be wrapped for the frame counters.
+     */
+    static bool isEnabled();
+
+    /*
+     * An ID the provider exposes, extra if not listed by the module itself.
+     */
+    static void exposed(int id, bool extra);
+
+    static void count(int id, Counter counter);
+    static void time(int id, Counter counter, nsecs_t durationNs);
+    static void error(int id, const camera3_error_msg_t *error);
+
+    static void dump(int fd);
+};
+
+#endif // PROVIDER_STATS_H
@@ -0,0 +1,930 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SamsungCameraDevice"
+
+#include "SamsungCameraDevice.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <cutils/properties.h>
+#include <log/log.h>
+#include <utils/Errors.h>
+
+#include "CameraPrewarmer.h"
+#include "OpenArbiter.h"
+#include "ProviderStats.h"
+
+using ::android::NO_ERROR;
+
+// Wrap opened devices and keep per-frame latencies for dump().
+const char *kLatencyStatsProp = "ro.vendor.camera.provider.latency_stats";
+// Wrap opened devices to trace their frames, only costs anything while tracing.
+const char *kFrameTraceProp = "ro.vendor.camera.provider.frame_trace";
+
+// Vendor answers to is_reconfiguration_required() kept, before starting over.
+const size_t kMaxReconfigurationAnswers = 64;
+
+// Frames in flight found without searching, the blob never gets near it.
+const uint32_t kInflightDepth = 64;
+
+// Flush durations kept for dump().
+const size_t kMaxFlushDurations = 64;
+
+// Power of two buckets in ms, the last one catches everything above.
+const int kNumHistogramBuckets = 12;
+
+static const char *streamTypeName(int type) {
+    switch (type) {
+        case CAMERA3_STREAM_OUTPUT:
+            return "out";
+        case CAMERA3_STREAM_INPUT:
+            return "in";
+        case CAMERA3_STREAM_BIDIRECTIONAL:
+            return "bidi";
+        default:
+            return "?";
+    }
+}
+
+static void appendMetadata(std::string *key, const camera_metadata_t *metadata) {
+    size_t size = metadata != nullptr ? get_camera_metadata_size(metadata) : 0;
+
+    key->append(reinterpret_cast<const char *>(&size), sizeof(size));
+    key->append(reinterpret_cast<const char *>(metadata), size);
+}
+
+static void dumpHistogram(int fd, const char *name, const std::vector<nsecs_t>& values) {
+    if (values.empty()) {
+        return;
+    }
+
+    uint32_t buckets[kNumHistogramBuckets] = {};
+    nsecs_t min = values[0], max = values[0], sum = 0;
+
+    for (nsecs_t value : values) {
+        int bucket = 0;
+        for (nsecs_t ms = ns2ms(value); ms > 0 && bucket < kNumHistogramBuckets - 1; ms >>= 1) {
+            bucket++;
+        }
+
+        buckets[bucket]++;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        sum += value;
+    }
+
+    dprintf(fd, "    %s: n=%zu min=%.2fms avg=%.2fms max=%.2fms\n", name, values.size(),
+            min / 1e6, static_cast<double>(sum) / values.size() / 1e6, max / 1e6);
+    dprintf(fd, "     ");
+    for (int i = 0; i < kNumHistogramBuckets - 1; i++) {
+        dprintf(fd, " <%d:%u", 1 << i, buckets[i]);
+    }
+    dprintf(fd, " >=%d:%u\n", 1 << (kNumHistogramBuckets - 2), buckets[kNumHistogramBuckets - 1]);
+}
+
+bool SamsungCameraDevice::isEnabled() {
+    static bool enabled = property_get_bool(kLatencyStatsProp, false) ||
+            property_get_bool(kFrameTraceProp, false) || CaptureRecorder::isEnabled() ||
+            SettingsCache::isEnabled() || HalBufferManager::isEnabled() || FlushWatchdog::isEnabled() ||
+            OpenArbiter::isEnabled() || JpegSizeTracker::isEnabled() ||
+            ProviderStats::isEnabled() || CameraPrewarmer::isEnabled();
+
+    return enabled;
+}
+
+hw_device_t *SamsungCameraDevice::wrap(int id, const camera_metadata_t *characteristics,
+                                       hw_device_t *device) {
+    if (device->version < CAMERA_DEVICE_API_VERSION_3_2) {
+        return device;
+    }
+
+    auto *wrapper = new SamsungCameraDevice(id, characteristics,
+                                            reinterpret_cast<camera3_device_t *>(device));
+    return &wrapper->mDevice.common;
+}
+
+SamsungCameraDevice::SamsungCameraDevice(int id, const camera_metadata_t *characteristics,
+                                         camera3_device_t *vendorDevice)
+    : mId(id),
+      mVendorDevice(vendorDevice),
+      mFrameworkCallbacks(nullptr),
+      mPartialResultCount(1),
+      mInflight(kInflightDepth),
+      mConfigId(0),
+      mNumReconfigurationQueries(0),
+      mNumReconfigurationCached(0),
+      mFlushCount(0),
+      mTracer(id),
+      mRecorder(CaptureRecorder::create(id, characteristics)),
+      mSettingsCache(SettingsCache::isEnabled() ? new SettingsCache() : nullptr),
+      mBufferManager(HalBufferManager::isEnabled() ? new HalBufferManager() : nullptr),
+      mJpegSizes(JpegSizeTracker::isEnabled() ? new JpegSizeTracker(id) : nullptr) {
+    const camera3_device_ops_t *vendorOps = vendorDevice->ops;
+
+    if (FlushWatchdog::isEnabled() && vendorOps->flush != nullptr) {
+        mFlushWatchdog.reset(new FlushWatchdog(vendorDevice));
+    }
+
+    // Only forward what the vendor implements, NULL means unsupported to the framework.
+    memset(&mOps, 0, sizeof(mOps));
+    mOps.initialize = sInitialize;
+    mOps.configure_streams = sConfigureStreams;
+    mOps.register_stream_buffers = vendorOps->register_stream_buffers ? sRegisterStreamBuffers : nullptr;
+    mOps.construct_default_request_settings = sConstructDefaultRequestSettings;
+    mOps.process_capture_request = sProcessCaptureRequest;
+    mOps.get_metadata_vendor_tag_ops =
+            vendorOps->get_metadata_vendor_tag_ops ? sGetMetadataVendorTagOps : nullptr;
+    mOps.dump = sDump;
+    mOps.flush = vendorOps->flush ? sFlush : nullptr;
+    // With buffer management the framework relies on it before reconfiguring.
+    mOps.signal_stream_flush =
+            vendorOps->signal_stream_flush || mBufferManager ? sSignalStreamFlush : nullptr;
+    mOps.is_reconfiguration_required =
+            vendorOps->is_reconfiguration_required ? sIsReconfigurationRequired : nullptr;
+
+    memset(&mCallbackOps, 0, sizeof(mCallbackOps));
+    mCallbackOps.device = this;
+
+    mDevice.common = vendorDevice->common;
+    mDevice.common.close = sClose;
+    mDevice.ops = &mOps;
+    mDevice.priv = this;
+
+    camera_metadata_ro_entry_t entry;
+    if (characteristics != nullptr &&
+            find_camera_metadata_ro_entry(characteristics, ANDROID_REQUEST_PARTIAL_RESULT_COUNT,
+                                          &entry) == 0 &&
+            entry.count == 1) {
+        mPartialResultCount = entry.data.i32[0];
+    }
+}
+
+SamsungCameraDevice *SamsungCameraDevice::from(const camera3_device *device) {
+    return static_cast<SamsungCameraDevice *>(device->priv);
+}
+
+SamsungCameraDevice *SamsungCameraDevice::from(const camera3_callback_ops_t *ops) {
+    return static_cast<const CallbackOps *>(ops)->device;
+}
+
+int SamsungCameraDevice::sClose(hw_device_t *device) {
+    SamsungCameraDevice *self = from(reinterpret_cast<camera3_device_t *>(device));
+
+    // A vendor flush past its deadline keeps the vendor device, and us, until it returns.
+    if (self->mFlushWatchdog != nullptr &&
+            self->mFlushWatchdog->detach([self] { self->closeVendor(); })) {
+        return NO_ERROR;
+    }
+
+    self->mFlushWatchdog.reset();
+    return self->closeVendor();
+}
+
+/*
+ * The vendor may still call back while closing, so we go away last.
+ */
+int SamsungCameraDevice::closeVendor() {
+    int rc = mVendorDevice->common.close(&mVendorDevice->common);
+
+    OpenArbiter::release(mId);
+    CameraPrewarmer::closed();
+    delete this;
+
+    return rc;
+}
+
+int SamsungCameraDevice::sInitialize(const camera3_device *device,
+                                     const camera3_callback_ops_t *ops) {
+    return from(device)->initialize(ops);
+}
+
+int SamsungCameraDevice::sConfigureStreams(const camera3_device *device,
+                                           camera3_stream_configuration_t *streamList) {
+    return from(device)->configureStreams(streamList);
+}
+
+int SamsungCameraDevice::sRegisterStreamBuffers(const camera3_device *device,
+                                                const camera3_stream_buffer_set_t *bufferSet) {
+    camera3_device_t *vendorDevice = from(device)->mVendorDevice;
+
+    return vendorDevice->ops->register_stream_buffers(vendorDevice, bufferSet);
+}
+
+const camera_metadata_t *SamsungCameraDevice::sConstructDefaultRequestSettings(
+        const camera3_device *device, int type) {
+    camera3_device_t *vendorDevice = from(device)->mVendorDevice;
+
+    return vendorDevice->ops->construct_default_request_settings(vendorDevice, type);
+}
+
+int SamsungCameraDevice::sProcessCaptureRequest(const camera3_device *device,
+                                                camera3_capture_request_t *request) {
+    return from(device)->processCaptureRequest(request);
+}
+
+void SamsungCameraDevice::sGetMetadataVendorTagOps(const camera3_device *device,
+                                                   vendor_tag_query_ops_t *ops) {
+    camera3_device_t *vendorDevice = from(device)->mVendorDevice;
+
+    vendorDevice->ops->get_metadata_vendor_tag_ops(vendorDevice, ops);
+}
+
+void SamsungCameraDevice::sDump(const camera3_device *device, int fd) {
+    from(device)->dump(fd);
+}
+
+int SamsungCameraDevice::sFlush(const camera3_device *device) {
+    return from(device)->flush();
+}
+
+void SamsungCameraDevice::sSignalStreamFlush(const camera3_device *device, uint32_t numStreams,
+                                             const camera3_stream_t *const *streams) {
+    camera3_device_t *vendorDevice = from(device)->mVendorDevice;
+
+    // Buffers are only fetched for requests, none are held outside of them.
+    if (vendorDevice->ops->signal_stream_flush != nullptr) {
+        vendorDevice->ops->signal_stream_flush(vendorDevice, numStreams, streams);
+    }
+}
+
+int SamsungCameraDevice::sIsReconfigurationRequired(const camera3_device *device,
+                                                    const camera_metadata_t *oldSessionParams,
+                                                    const camera_metadata_t *newSessionParams) {
+    return from(device)->isReconfigurationRequired(oldSessionParams, newSessionParams);
+}
+
+void SamsungCameraDevice::sProcessCaptureResult(const camera3_callback_ops_t *ops,
+                                                const camera3_capture_result_t *result) {
+    SamsungCameraDevice *self = from(ops);
+    FlushWatchdog *watchdog = self->mFlushWatchdog.get();
+
+    if (watchdog == nullptr) {
+        self->processCaptureResult(result);
+    } else if (watchdog->enter(result->frame_number)) {
+        self->processCaptureResult(result);
+        watchdog->leave();
+    } else if ((result->num_output_buffers > 0 || result->input_buffer != nullptr) &&
+               watchdog->enterAny()) {
+        // Failed already, the buffers were held back until the blob is done with them.
+        std::vector<camera3_stream_buffer_t> buffers(
+                result->output_buffers, result->output_buffers + result->num_output_buffers);
+        for (camera3_stream_buffer_t& buffer : buffers) {
+            buffer.status = CAMERA3_BUFFER_STATUS_ERROR;
+        }
+
+        camera3_stream_buffer_t inputBuffer;
+        camera3_capture_result_t buffersOnly;
+        memset(&buffersOnly, 0, sizeof(buffersOnly));
+        buffersOnly.frame_number = result->frame_number;
+        buffersOnly.num_output_buffers = buffers.size();
+        buffersOnly.output_buffers = buffers.empty() ? nullptr : buffers.data();
+        if (result->input_buffer != nullptr) {
+            inputBuffer = *result->input_buffer;
+            inputBuffer.status = CAMERA3_BUFFER_STATUS_ERROR;
+            buffersOnly.input_buffer = &inputBuffer;
+        }
+        self->processCaptureResult(&buffersOnly);
+        watchdog->leave();
+    }
+}
+
+void SamsungCameraDevice::sNotify(const camera3_callback_ops_t *ops,
+                                  const camera3_notify_msg_t *msg) {
+    SamsungCameraDevice *self = from(ops);
+    FlushWatchdog *watchdog = self->mFlushWatchdog.get();
+
+    if (watchdog == nullptr) {
+        self->notify(msg);
+    } else if (msg->type == CAMERA3_MSG_ERROR &&
+               msg->message.error.error_code == CAMERA3_MSG_ERROR_DEVICE) {
+        // A dead device is always worth hearing about, until closed.
+        if (watchdog->enterAny()) {
+            self->notify(msg);
+            watchdog->leave();
+        }
+    } else if (watchdog->enter(msg->type == CAMERA3_MSG_SHUTTER ?
+                                       msg->message.shutter.frame_number :
+                                       msg->message.error.frame_number)) {
+        self->notify(msg);
+        watchdog->leave();
+    }
+}
+
+camera3_buffer_request_status_t SamsungCameraDevice::sRequestStreamBuffers(
+        const camera3_callback_ops_t *ops, uint32_t numBufferReqs,
+        const camera3_buffer_request_t *bufferReqs, uint32_t *numReturnedBufReqs,
+        camera3_stream_buffer_ret_t *returnedBufReqs) {
+    const camera3_callback_ops_t *callbacks = from(ops)->mFrameworkCallbacks;
+
+    return callbacks->request_stream_buffers(callbacks, numBufferReqs, bufferReqs,
+                                             numReturnedBufReqs, returnedBufReqs);
+}
+
+void SamsungCameraDevice::sReturnStreamBuffers(const camera3_callback_ops_t *ops,
+                                               uint32_t numBuffers,
+                                               const camera3_stream_buffer_t *const *buffers) {
+    const camera3_callback_ops_t *callbacks = from(ops)->mFrameworkCallbacks;
+
+    callbacks->return_stream_buffers(callbacks, numBuffers, buffers);
+}
+
+int SamsungCameraDevice::initialize(const camera3_callback_ops_t *ops) {
+    mFrameworkCallbacks = ops;
+
+    mCallbackOps.process_capture_result = sProcessCaptureResult;
+    mCallbackOps.notify = sNotify;
+    mCallbackOps.request_stream_buffers = ops->request_stream_buffers ? sRequestStreamBuffers : nullptr;
+    mCallbackOps.return_stream_buffers = ops->return_stream_buffers ? sReturnStreamBuffers : nullptr;
+
+    if (mBufferManager != nullptr) {
+        mBufferManager->initialize(ops);
+    }
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    int rc = mVendorDevice->ops->initialize(mVendorDevice, &mCallbackOps);
+    OpenArbiter::initialized(mId, systemTime(SYSTEM_TIME_MONOTONIC) - start);
+
+    return rc;
+}
+
+int SamsungCameraDevice::configureStreams(camera3_stream_configuration_t *streamList) {
+    char config[1024];
+    size_t len = snprintf(config, sizeof(config), "mode 0x%x:", streamList->operation_mode);
+
+    for (uint32_t i = 0; i < streamList->num_streams && len < sizeof(config); i++) {
+        const camera3_stream_t *stream = streamList->streams[i];
+        len += snprintf(config + len, sizeof(config) - len, " %ux%u/0x%x/%s/0x%" PRIx64 "/0x%x/%d",
+                        stream->width, stream->height, stream->format,
+                        streamTypeName(stream->stream_type), static_cast<uint64_t>(stream->usage),
+                        stream->data_space, stream->rotation);
+    }
+
+    // The first request after a configuration must carry settings.
+    if (mSettingsCache != nullptr) {
+        mSettingsCache->reset();
+    }
+    if (mFlushWatchdog != nullptr) {
+        mFlushWatchdog->waitForVendor();
+    }
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    int rc = mVendorDevice->ops->configure_streams(mVendorDevice, streamList);
+    nsecs_t duration = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    if (rc != NO_ERROR) {
+        return rc;
+    }
+    ProviderStats::time(mId, ProviderStats::CONFIGURE, duration);
+
+    char negotiated[512];
+    len = 0;
+    negotiated[0] = '\0';
+    for (uint32_t i = 0; i < streamList->num_streams && len < sizeof(negotiated); i++) {
+        const camera3_stream_t *stream = streamList->streams[i];
+        len += snprintf(negotiated + len, sizeof(negotiated) - len, " %u/0x%" PRIx64,
+                        stream->max_buffers, static_cast<uint64_t>(stream->usage));
+    }
+
+    mTracer.configure(streamList);
+    if (mRecorder != nullptr) {
+        mRecorder->configure(streamList);
+    }
+    if (mJpegSizes != nullptr) {
+        mJpegSizes->configure(streamList);
+    }
+
+    std::lock_guard<std::mutex> lock(mConfigLock);
+
+    // Reuse the ID of an identical configuration, e.g. when switching back to a mode.
+    auto it = std::find_if(mConfigs.begin(), mConfigs.end(),
+                           [&](const StreamConfig& c) { return c.streams == config; });
+    if (it == mConfigs.end()) {
+        it = mConfigs.insert(mConfigs.end(), StreamConfig{config, negotiated, 0, 0, 0, 0, 0});
+    } else if (it->negotiated != negotiated) {
+        it->negotiated = negotiated;
+        it->numRenegotiated++;
+    }
+
+    it->numConfigured++;
+    it->lastNs = duration;
+    it->maxNs = std::max(it->maxNs, duration);
+    it->totalNs += duration;
+    mConfigId = it - mConfigs.begin();
+
+    return rc;
+}
+
+int SamsungCameraDevice::processCaptureRequest(camera3_capture_request_t *request) {
+    if (mFlushWatchdog != nullptr) {
+        mFlushWatchdog->waitForVendor();
+    }
+
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    ProviderStats::count(mId, ProviderStats::REQUEST);
+
+    // Before handing it on, results may arrive before the vendor call returns.
+    size_t numInflight;
+    {
+        std::lock_guard<std::mutex> lock(mInflightLock);
+        InflightFrame *frame = mInflight.insert(request->frame_number);
+
+        frame->requestNs = now;
+        frame->shutterNs = -1;
+        frame->partialResultNs = -1;
+        frame->finalResultNs = -1;
+        frame->configId = mConfigId;
+        frame->pendingBuffers = request->num_output_buffers + (request->input_buffer ? 1 : 0);
+        frame->metadataDone = false;
+        frame->failed = false;
+        // Reusing the slot's vector, nothing is allocated past the first frames.
+        frame->outputBuffers.clear();
+        if (mFlushWatchdog != nullptr) {
+            frame->outputBuffers.assign(request->output_buffers,
+                                        request->output_buffers + request->num_output_buffers);
+        }
+
+        numInflight = mInflight.size();
+    }
+    mTracer.request(request, numInflight);
+    if (mRecorder != nullptr) {
+        mRecorder->request(request);
+    }
+    if (mJpegSizes != nullptr) {
+        mJpegSizes->request(request);
+    }
+
+    // Hand the framework's request back as it came once the vendor is done with it.
+    const camera3_stream_buffer_t *outputBuffers = request->output_buffers;
+    std::vector<camera3_stream_buffer_t> fetchedBuffers;
+    if (mBufferManager != nullptr) {
+        HalBufferManager::Result result = mBufferManager->fetch(request, &fetchedBuffers);
+        if (result != HalBufferManager::FETCHED) {
+            return failRequest(request, fetchedBuffers, result);
+        }
+        request->output_buffers = fetchedBuffers.data();
+
+        if (mFlushWatchdog != nullptr) {
+            std::lock_guard<std::mutex> lock(mInflightLock);
+            InflightFrame *frame = mInflight.find(request->frame_number);
+            if (frame != nullptr) {
+                frame->outputBuffers = fetchedBuffers;
+            }
+        }
+    }
+
+    const camera_metadata_t *settings = request->settings;
+    if (mSettingsCache != nullptr) {
+        request->settings = mSettingsCache->filter(request);
+    }
+
+    int rc = mVendorDevice->ops->process_capture_request(mVendorDevice, request);
+    request->settings = settings;
+    request->output_buffers = outputBuffers;
+    if (rc != NO_ERROR) {
+        if (mSettingsCache != nullptr) {
+            mSettingsCache->reset();
+        }
+        if (mJpegSizes != nullptr) {
+            mJpegSizes->cancel(request->frame_number);
+        }
+        if (mBufferManager != nullptr) {
+            mBufferManager->giveBack(request, fetchedBuffers);
+        }
+
+        std::lock_guard<std::mutex> lock(mInflightLock);
+        mInflight.erase(request->frame_number);
+        mTracer.complete(request->frame_number, mInflight.size());
+    }
+
+    return rc;
+}
+
+/*
+ * The vendor may not change anything when asked, so its answer for the same
+ * configuration and session parameters can be given again without asking.
+ */
+int SamsungCameraDevice::isReconfigurationRequired(const camera_metadata_t *oldSessionParams,
+                                                   const camera_metadata_t *newSessionParams) {
+    uint32_t configId = mConfigId;
+    std::string key(reinterpret_cast<const char *>(&configId), sizeof(configId));
+    appendMetadata(&key, oldSessionParams);
+    appendMetadata(&key, newSessionParams);
+
+    mNumReconfigurationQueries++;
+    {
+        std::lock_guard<std::mutex> lock(mConfigLock);
+
+        auto it = mReconfigurationAnswers.find(key);
+        if (it != mReconfigurationAnswers.end()) {
+            mNumReconfigurationCached++;
+            return it->second;
+        }
+    }
+
+    int rc = mVendorDevice->ops->is_reconfiguration_required(mVendorDevice, oldSessionParams,
+                                                             newSessionParams);
+
+    std::lock_guard<std::mutex> lock(mConfigLock);
+    if (mReconfigurationAnswers.size() >= kMaxReconfigurationAnswers) {
+        mReconfigurationAnswers.clear();
+    }
+    mReconfigurationAnswers.emplace(std::move(key), rc);
+
+    return rc;
+}
+
+int SamsungCameraDevice::flush() {
+    if (mBufferManager != nullptr) {
+        mBufferManager->flush();
+    }
+
+    // Flushed requests may never have had their settings applied.
+    if (mSettingsCache != nullptr) {
+        mSettingsCache->reset();
+    }
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    int rc = NO_ERROR;
+    if (mFlushWatchdog == nullptr) {
+        rc = mVendorDevice->ops->flush(mVendorDevice);
+    } else if (!mFlushWatchdog->flush(&rc)) {
+        failInflight();
+    }
+    nsecs_t duration = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+
+    std::lock_guard<std::mutex> lock(mFlushLock);
+    if (mFlushDurations.size() >= kMaxFlushDurations) {
+        mFlushDurations.erase(mFlushDurations.begin());
+    }
+    mFlushDurations.push_back(duration);
+    mFlushCount++;
+
+    return rc;
+}
+
+void SamsungCameraDevice::dump(int fd) {
+    dprintf(fd, "Samsung camera device %d:\n", mId);
+    dprintf(fd, "  Partial result count: %u\n", mPartialResultCount);
+    {
+        std::lock_guard<std::mutex> lock(mFlushLock);
+        dprintf(fd, "  Flushes: %u\n", mFlushCount);
+        dumpHistogram(fd, "Flush", mFlushDurations);
+    }
+    if (mFlushWatchdog != nullptr) {
+        mFlushWatchdog->dump(fd);
+        dumpHistogram(fd, "Vendor flush", mFlushWatchdog->vendorDurations());
+    }
+    if (mSettingsCache != nullptr) {
+        dprintf(fd, "  Request settings: %u forwarded, %u replaced by NULL\n",
+                mSettingsCache->numForwarded(), mSettingsCache->numElided());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mInflightLock);
+        dprintf(fd, "  In flight frames: %zu, %" PRIu64 " did not fit the ring of %zu\n",
+                mInflight.size(), mInflight.numOverflowed(), mInflight.capacity());
+    }
+
+    if (mBufferManager != nullptr) {
+        mBufferManager->dump(fd);
+    }
+    if (mJpegSizes != nullptr) {
+        mJpegSizes->dump(fd);
+    }
+
+    dumpConfigurations(fd);
+    dumpLatencies(fd);
+    OpenArbiter::dump(fd);
+
+    mVendorDevice->ops->dump(mVendorDevice, fd);
+}
+
+void SamsungCameraDevice::dumpConfigurations(int fd) {
+    std::lock_guard<std::mutex> lock(mConfigLock);
+
+    dprintf(fd, "  Stream configurations:\n");
+    for (uint32_t id = 0; id < mConfigs.size(); id++) {
+        const StreamConfig& config = mConfigs[id];
+
+        dprintf(fd, "  Configuration %u, %s\n", id, config.streams.c_str());
+        dprintf(fd, "    Configured %u times, last %.2fms, avg %.2fms, max %.2fms\n",
+                config.numConfigured, config.lastNs / 1e6,
+                static_cast<double>(config.totalNs) / config.numConfigured / 1e6,
+                config.maxNs / 1e6);
+        dprintf(fd, "    Negotiated max buffers/usage:%s, changed %u times\n",
+                config.negotiated.c_str(), config.numRenegotiated);
+    }
+
+    if (mVendorDevice->ops->is_reconfiguration_required != nullptr) {
+        dprintf(fd, "  Reconfiguration queries: %u, %u answered from cache\n",
+                mNumReconfigurationQueries.load(), mNumReconfigurationCached.load());
+    }
+}
+
+void SamsungCameraDevice::dumpLatencies(int fd) {
+    std::vector<FrameLatency> latencies = mLatencies.snapshot();
+    std::vector<std::string> configs;
+
+    {
+        std::lock_guard<std::mutex> lock(mConfigLock);
+        for (const StreamConfig& config : mConfigs) {
+            configs.push_back(config.streams);
+        }
+    }
+
+    dprintf(fd, "  Latency of the last %zu frames:\n", latencies.size());
+
+    for (uint32_t id = 0; id < configs.size(); id++) {
+        std::vector<nsecs_t> shutter, partialResult, finalResult, complete;
+        uint32_t failed = 0;
+
+        for (const FrameLatency& latency : latencies) {
+            if (latency.configId != id) {
+                continue;
+            }
+
+            if (latency.failed) failed++;
+            if (latency.shutterNs >= 0) shutter.push_back(latency.shutterNs);
+            if (latency.partialResultNs >= 0) partialResult.push_back(latency.partialResultNs);
+            if (latency.finalResultNs >= 0) finalResult.push_back(latency.finalResultNs);
+            complete.push_back(latency.completeNs);
+        }
+
+        if (complete.empty()) {
+            continue;
+        }
+
+        dprintf(fd, "  Configuration %u, %s\n", id, configs[id].c_str());
+        dprintf(fd, "    Failed frames: %u\n", failed);
+        dumpHistogram(fd, "Shutter lag", shutter);
+        if (mPartialResultCount > 1) {
+            dumpHistogram(fd, "First partial result lag", partialResult);
+        }
+        dumpHistogram(fd, "Final result lag", finalResult);
+        dumpHistogram(fd, "Completion lag", complete);
+    }
+}
+
+void SamsungCameraDevice::processCaptureResult(const camera3_capture_result_t *result) {
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    {
+        std::lock_guard<std::mutex> lock(mInflightLock);
+
+        InflightFrame *inflight = mInflight.find(result->frame_number);
+        if (inflight != nullptr) {
+            InflightFrame& frame = *inflight;
+            uint32_t buffers = result->num_output_buffers + (result->input_buffer ? 1 : 0);
+
+            if (result->partial_result > 0 && frame.partialResultNs < 0) {
+                frame.partialResultNs = now - frame.requestNs;
+            }
+            if (result->partial_result == mPartialResultCount) {
+                frame.finalResultNs = now - frame.requestNs;
+                frame.metadataDone = true;
+            }
+            frame.pendingBuffers -= std::min(frame.pendingBuffers, buffers);
+
+            for (uint32_t i = 0; i < result->num_output_buffers; i++) {
+                const camera3_stream_t *stream = result->output_buffers[i].stream;
+                auto buffer = std::find_if(frame.outputBuffers.begin(), frame.outputBuffers.end(),
+                        [stream](const camera3_stream_buffer_t& b) { return b.stream == stream; });
+                if (buffer != frame.outputBuffers.end()) {
+                    frame.outputBuffers.erase(buffer);
+                }
+            }
+
+            finishIfDoneLocked(result->frame_number, frame, now);
+        }
+    }
+
+    mTracer.result(result);
+    if (mRecorder != nullptr) {
+        mRecorder->result(result);
+    }
+    if (mJpegSizes != nullptr) {
+        mJpegSizes->result(result);
+    }
+    if (mBufferManager != nullptr) {
+        mBufferManager->returned(result->num_output_buffers);
+    }
+
+    mFrameworkCallbacks->process_capture_result(mFrameworkCallbacks, result);
+}
+
+void SamsungCameraDevice::notify(const camera3_notify_msg_t *msg) {
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    {
+        std::lock_guard<std::mutex> lock(mInflightLock);
+
+        if (msg->type == CAMERA3_MSG_SHUTTER) {
+            InflightFrame *frame = mInflight.find(msg->message.shutter.frame_number);
+            if (frame != nullptr) {
+                frame->shutterNs = now - frame->requestNs;
+            }
+        } else if (msg->type == CAMERA3_MSG_ERROR) {
+            uint32_t frameNumber = msg->message.error.frame_number;
+            InflightFrame *frame = mInflight.find(frameNumber);
+            int code = msg->message.error.error_code;
+
+            if (code == CAMERA3_MSG_ERROR_DEVICE) {
+                // Nothing else is coming back from a dead device.
+                mInflight.clear();
+            } else if (frame != nullptr) {
+                frame->failed = true;
+                // No metadata follows either error, buffers still do.
+                if (code == CAMERA3_MSG_ERROR_REQUEST || code == CAMERA3_MSG_ERROR_RESULT) {
+                    frame->metadataDone = true;
+                }
+
+                finishIfDoneLocked(frameNumber, *frame, now);
+            }
+        }
+    }
+
+    if (msg->type == CAMERA3_MSG_SHUTTER) {
+        mTracer.shutter(msg->message.shutter.frame_number);
+    } else if (msg->type == CAMERA3_MSG_ERROR) {
+        mTracer.error(&msg->message.error);
+        ProviderStats::error(mId, &msg->message.error);
+    }
+    if (mRecorder != nullptr) {
+        mRecorder->notify(msg);
+    }
+
+    mFrameworkCallbacks->notify(mFrameworkCallbacks, msg);
+}
+
+/*
+ * Fail a request the blob never saw, giving back whatever buffers were
+ * fetched for it.
+ */
+int SamsungCameraDevice::failRequest(const camera3_capture_request_t *request,
+                                     std::vector<camera3_stream_buffer_t>& buffers,
+                                     HalBufferManager::Result result) {
+    if (result == HalBufferManager::DEVICE_ERROR) {
+        mBufferManager->giveBack(request, buffers);
+    }
+
+    // Buffers that couldn't be fetched were never the device's, nothing comes back for them.
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                 [](const camera3_stream_buffer_t& buffer) {
+                                     return buffer.buffer == nullptr || *buffer.buffer == nullptr;
+                                 }),
+                  buffers.end());
+    {
+        std::lock_guard<std::mutex> lock(mInflightLock);
+        InflightFrame *frame = mInflight.find(request->frame_number);
+        if (frame != nullptr) {
+            frame->pendingBuffers = buffers.size() + (request->input_buffer ? 1 : 0);
+            if (mFlushWatchdog != nullptr) {
+                frame->outputBuffers = buffers;
+            }
+        }
+    }
+
+    if (mJpegSizes != nullptr) {
+        mJpegSizes->cancel(request->frame_number);
+    }
+
+    camera3_notify_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = CAMERA3_MSG_ERROR;
+    msg.message.error.frame_number = request->frame_number;
+    msg.message.error.error_code = result == HalBufferManager::DEVICE_ERROR ?
+            CAMERA3_MSG_ERROR_DEVICE : CAMERA3_MSG_ERROR_REQUEST;
+    notify(&msg);
+
+    if (result == HalBufferManager::DEVICE_ERROR) {
+        return -ENODEV;
+    }
+
+    for (camera3_stream_buffer_t& buffer : buffers) {
+        buffer.status = CAMERA3_BUFFER_STATUS_ERROR;
+        buffer.release_fence = buffer.acquire_fence;
+        buffer.acquire_fence = -1;
+    }
+
+    if (buffers.empty() && request->input_buffer == nullptr) {
+        return NO_ERROR;
+    }
+
+    camera3_stream_buffer_t inputBuffer;
+    camera3_capture_result_t captureResult;
+    memset(&captureResult, 0, sizeof(captureResult));
+    captureResult.frame_number = request->frame_number;
+    captureResult.num_output_buffers = buffers.size();
+    captureResult.output_buffers = buffers.empty() ? nullptr : buffers.data();
+    if (request->input_buffer != nullptr) {
+        inputBuffer = *request->input_buffer;
+        inputBuffer.status = CAMERA3_BUFFER_STATUS_ERROR;
+        inputBuffer.release_fence = inputBuffer.acquire_fence;
+        inputBuffer.acquire_fence = -1;
+        captureResult.input_buffer = &inputBuffer;
+    }
+    processCaptureResult(&captureResult);
+
+    return NO_ERROR;
+}
+
+/*
+ * Fail every frame still in flight after the vendor flush missed its
+ * deadline, as the blob would have. Frames without a shutter fail as a
+ * whole, the others get whatever is still missing failed.
+ *
+ * Only the errors are sent now. The blob may still be writing to the
+ * buffers, they go back once it returns them, with its release fences.
+ */
+void SamsungCameraDevice::failInflight() {
+    uint32_t lastFrameNumber;
+    {
+        std::lock_guard<std::mutex> lock(mInflightLock);
+        if (mInflight.empty()) {
+            return;
+        }
+        lastFrameNumber = mInflight.frameNumbers().back();
+    }
+
+    // Callbacks of the blob for these frames wait until all errors went out.
+    mFlushWatchdog->abandon(lastFrameNumber, [this, lastFrameNumber] {
+        std::vector<std::pair<uint32_t, InflightFrame>> frames;
+        {
+            std::lock_guard<std::mutex> lock(mInflightLock);
+            for (uint32_t frameNumber : mInflight.frameNumbers()) {
+                if (frameNumber <= lastFrameNumber) {
+                    frames.emplace_back(frameNumber, *mInflight.find(frameNumber));
+                }
+            }
+        }
+        ALOGW("Failing %zu frames up to %u after flush timeout", frames.size(), lastFrameNumber);
+
+        for (const auto& [frameNumber, frame] : frames) {
+            camera3_notify_msg_t msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.type = CAMERA3_MSG_ERROR;
+            msg.message.error.frame_number = frameNumber;
+
+            if (frame.shutterNs < 0) {
+                msg.message.error.error_code = CAMERA3_MSG_ERROR_REQUEST;
+                notify(&msg);
+                continue;
+            }
+
+            if (!frame.metadataDone) {
+                msg.message.error.error_code = CAMERA3_MSG_ERROR_RESULT;
+                notify(&msg);
+            }
+            msg.message.error.error_code = CAMERA3_MSG_ERROR_BUFFER;
+            for (const camera3_stream_buffer_t& buffer : frame.outputBuffers) {
+                msg.message.error.error_stream = buffer.stream;
+                notify(&msg);
+            }
+        }
+    });
+}
+
+/*
+ * A frame is done once its final metadata, or an error in its place, and
+ * every buffer made it back.
+ */
+void SamsungCameraDevice::finishIfDoneLocked(uint32_t frameNumber, const InflightFrame& frame,
+                                             nsecs_t now) {
+    if (!frame.metadataDone || frame.pendingBuffers > 0) {
+        return;
+    }
+
+    mLatencies.push({
+        .frameNumber = frameNumber,
+        .configId = frame.configId,
+        .shutterNs = frame.shutterNs,
+        .partialResultNs = frame.partialResultNs,
+        .finalResultNs = frame.finalResultNs,
+        .completeNs = now - frame.requestNs,
+        .failed = frame.failed,
+    });
+    if (frame.failed) {
+        ProviderStats::count(mId, ProviderStats::DROPPED_FRAME);
+    }
+
+    mInflight.erase(frameNumber);
+    mTracer.complete(frameNumber, mInflight.size());
+}
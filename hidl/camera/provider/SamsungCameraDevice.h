@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMSUNG_CAMERA_DEVICE_H
+#define SAMSUNG_CAMERA_DEVICE_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <hardware/camera3.h>
+
+#include "CaptureRecorder.h"
+#include "FlushWatchdog.h"
+#include "FrameTracer.h"
+#include "HalBufferManager.h"
+#include "InflightRing.h"
+#include "JpegSizeTracker.h"
+#include "LatencyRing.h"
+#include "SettingsCache.h"
+
+/*
+ * Interposes on a camera3_device opened from the vendor module.
+ *
+ * The framework is handed a camera3_device of our own whose ops forward to
+ * the vendor device, and the vendor device is handed callback ops of our
+ * own that forward to the framework. Both directions are timestamped, and
+ * the latencies of every completed frame are kept per stream configuration
+ * and printed by dump(). The frame lifecycle is also traced through
+ * FrameTracer, and can be recorded for replay through CaptureRecorder.
+ * Repeated request settings can be kept from the blob through
+ * SettingsCache, buffers fetched from the framework on demand through
+ * HalBufferManager, a blob stuck in flush() cut short through
+ * FlushWatchdog, and the size of every JPEG kept through JpegSizeTracker.
+ */
+class SamsungCameraDevice {
+public:
+    /*
+     * Whether opened devices should be wrapped at all.
+     */
+    static bool isEnabled();
+
+    /*
+     * Wrap a freshly opened device. Returns the device to hand out, which is
+     * the vendor one unchanged if it isn't a HAL3 device. The static
+     * characteristics must outlive the device, they may be NULL.
+     */
+    static hw_device_t *wrap(int id, const camera_metadata_t *characteristics,
+                             hw_device_t *device);
+
+private:
+    struct CallbackOps : public camera3_callback_ops_t {
+        SamsungCameraDevice *device;
+    };
+
+    struct StreamConfig {
+        // Everything the framework asked for, what identifies the configuration.
+        std::string streams;
+        // max_buffers and usage the vendor settled on, last time.
+        std::string negotiated;
+        uint32_t numConfigured;
+        // Times the vendor settled on something else for the same streams.
+        uint32_t numRenegotiated;
+        nsecs_t lastNs;
+        nsecs_t maxNs;
+        nsecs_t totalNs;
+    };
+
+    struct InflightFrame {
+        nsecs_t requestNs;
+        nsecs_t shutterNs;
+        nsecs_t partialResultNs;
+        nsecs_t finalResultNs;
+        uint32_t configId;
+        uint32_t pendingBuffers;
+        bool metadataDone;
+        bool failed;
+        // Buffers not back yet, only kept to fail the frame on flush timeout.
+        std::vector<camera3_stream_buffer_t> outputBuffers;
+    };
+
+    SamsungCameraDevice(int id, const camera_metadata_t *characteristics,
+                        camera3_device_t *vendorDevice);
+
+    static SamsungCameraDevice *from(const camera3_device *device);
+    static SamsungCameraDevice *from(const camera3_callback_ops_t *ops);
+
+    static int sClose(hw_device_t *device);
+    static int sInitialize(const camera3_device *device, const camera3_callback_ops_t *ops);
+    static int sConfigureStreams(const camera3_device *device,
+                                 camera3_stream_configuration_t *streamList);
+    static int sRegisterStreamBuffers(const camera3_device *device,
+                                      const camera3_stream_buffer_set_t *bufferSet);
+    static const camera_metadata_t *sConstructDefaultRequestSettings(const camera3_device *device,
+                                                                     int type);
+    static int sProcessCaptureRequest(const camera3_device *device,
+                                      camera3_capture_request_t *request);
+    static void sGetMetadataVendorTagOps(const camera3_device *device, vendor_tag_query_ops_t *ops);
+    static void sDump(const camera3_device *device, int fd);
+    static int sFlush(const camera3_device *device);
+    static void sSignalStreamFlush(const camera3_device *device, uint32_t numStreams,
+                                   const camera3_stream_t *const *streams);
+    static int sIsReconfigurationRequired(const camera3_device *device,
+                                          const camera_metadata_t *oldSessionParams,
+                                          const camera_metadata_t *newSessionParams);
+
+    static void sProcessCaptureResult(const camera3_callback_ops_t *ops,
+                                      const camera3_capture_result_t *result);
+    static void sNotify(const camera3_callback_ops_t *ops, const camera3_notify_msg_t *msg);
+    static camera3_buffer_request_status_t sRequestStreamBuffers(
+            const camera3_callback_ops_t *ops, uint32_t numBufferReqs,
+            const camera3_buffer_request_t *bufferReqs, uint32_t *numReturnedBufReqs,
+            camera3_stream_buffer_ret_t *returnedBufReqs);
+    static void sReturnStreamBuffers(const camera3_callback_ops_t *ops, uint32_t numBuffers,
+                                     const camera3_stream_buffer_t *const *buffers);
+
+    int closeVendor();
+    int initialize(const camera3_callback_ops_t *ops);
+    int configureStreams(camera3_stream_configuration_t *streamList);
+    int processCaptureRequest(camera3_capture_request_t *request);
+    int flush();
+    int isReconfigurationRequired(const camera_metadata_t *oldSessionParams,
+                                  const camera_metadata_t *newSessionParams);
+    void dump(int fd);
+    void processCaptureResult(const camera3_capture_result_t *result);
+    void notify(const camera3_notify_msg_t *msg);
+
+    int failRequest(const camera3_capture_request_t *request,
+                    std::vector<camera3_stream_buffer_t>& buffers, HalBufferManager::Result result);
+    void failInflight();
+    void finishIfDoneLocked(uint32_t frameNumber, const InflightFrame& frame, nsecs_t now);
+    void dumpConfigurations(int fd);
+    void dumpLatencies(int fd);
+
+    // Handed out to the framework, its priv points back to us.
+    camera3_device_t mDevice;
+    camera3_device_ops_t mOps;
+    CallbackOps mCallbackOps;
+
+    int mId;
+    camera3_device_t *mVendorDevice;
+    const camera3_callback_ops_t *mFrameworkCallbacks;
+    uint32_t mPartialResultCount;
+
+    std::mutex mInflightLock;
+    InflightRing<InflightFrame> mInflight;
+
+    // Every configuration seen so far, indexed by config ID.
+    std::mutex mConfigLock;
+    std::vector<StreamConfig> mConfigs;
+    std::atomic<uint32_t> mConfigId;
+    // Answers of the vendor by config ID and old and new session parameters.
+    std::map<std::string, int> mReconfigurationAnswers;
+    std::atomic<uint32_t> mNumReconfigurationQueries;
+    std::atomic<uint32_t> mNumReconfigurationCached;
+
+    // How long the last flushes kept the framework waiting, oldest first.
+    std::mutex mFlushLock;
+    std::vector<nsecs_t> mFlushDurations;
+    uint32_t mFlushCount;
+
+    LatencyRing mLatencies;
+    FrameTracer mTracer;
+    std::unique_ptr<CaptureRecorder> mRecorder;
+    std::unique_ptr<SettingsCache> mSettingsCache;
+    std::unique_ptr<HalBufferManager> mBufferManager;
+    std::unique_ptr<JpegSizeTracker> mJpegSizes;
+    // Last, so a vendor flush still running is waited on, or is what deletes us once
+    // detached, before anything goes away.
+    std::unique_ptr<FlushWatchdog> mFlushWatchdog;
+};
+
+#endif // SAMSUNG_CAMERA_DEVICE_H
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SamsungCameraModule"
+
+#include "SamsungCameraModule.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <cutils/properties.h>
+#include <log/log.h>
+#include <utils/Errors.h>
+#include <utils/Timers.h>
+
+#include "CameraInfoStore.h"
+#include "CameraPrewarmer.h"
+#include "HalBufferManager.h"
+#include "JpegSizeTracker.h"
+#include "OpenArbiter.h"
+#include "ProviderStats.h"
+#include "SamsungCameraDevice.h"
+
+using ::android::NO_ERROR;
+
+/*
+ * Keep probed camera_info in /data/vendor/camera across restarts. Off by
+ * default, also in the lazy provider: a stored ID is never asked of the
+ * blob, so whatever its get_camera_info() sets up before open() is
+ * skipped. Only turn it on once open() is known to work on a cold boot
+ * served entirely from the store.
+ */
+const char *kInfoStoreProp = "ro.vendor.camera.provider.info_store";
+
+static std::mutex sLock;
+static camera_module_t *sModule;
+static int (*sVendorGetCameraInfo)(int id, struct camera_info *info);
+static int (*sVendorOpen)(const hw_module_t *module, const char *id, hw_device_t **device);
+static int (*sVendorInit)();
+static std::map<int, camera_info> sCameraInfoCache;
+static bool sCameraInfoStored;
+// Set when an ID was probed live and the store is out of date.
+static bool sCameraInfoDirty;
+// Characteristics handed out in place of the vendor ones, never freed.
+static std::map<int, camera_metadata_t *> sAdvertisedCharacteristics;
+static bool sHalBufferManagement;
+
+/*
+ * The module struct may sit in a read-only segment of the blob, so make its
+ * page writable before replacing one of its pointers.
+ */
+template <typename T>
+static bool patch(T *slot, T value) {
+    uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = reinterpret_cast<uintptr_t>(slot) & ~(pageSize - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(slot + 1);
+
+    if (mprotect(reinterpret_cast<void *>(start), end - start, PROT_READ | PROT_WRITE) != 0) {
+        ALOGE("Failed to make vendor module writable: %s", strerror(errno));
+        return false;
+    }
+
+    *slot = value;
+    return true;
+}
+
+bool SamsungCameraModule::hook() {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    if (sModule != nullptr) {
+        return true;
+    }
+
+    // Same module CameraModule wraps, hw_get_module() hands out one instance.
+    const hw_module_t *rawModule;
+    if (hw_get_module(CAMERA_HARDWARE_MODULE_ID, &rawModule) != 0) {
+        ALOGE("Could not load camera HAL module");
+        return false;
+    }
+
+    camera_module_t *module = reinterpret_cast<camera_module_t *>(const_cast<hw_module_t *>(rawModule));
+    auto vendorGetCameraInfo = module->get_camera_info;
+    if (!patch(&module->get_camera_info, &SamsungCameraModule::sGetCameraInfo)) {
+        return false;
+    }
+
+    sVendorGetCameraInfo = vendorGetCameraInfo;
+    sModule = module;
+
+    if (SamsungCameraDevice::isEnabled() || CameraPrewarmer::isEnabled()) {
+        auto vendorOpen = module->common.methods->open;
+        if (patch(&module->common.methods->open, &SamsungCameraModule::sOpen)) {
+            sVendorOpen = vendorOpen;
+            // Only with every device wrapped to fetch the buffers.
+            sHalBufferManagement = HalBufferManager::isEnabled();
+
+            if (CameraPrewarmer::isEnabled()) {
+                auto vendorInit = module->init;
+                // CameraModule only initializes modules from 2.4 on, older ones are ready as is.
+                if (module->common.module_api_version < CAMERA_MODULE_API_VERSION_2_4) {
+                    CameraPrewarmer::start(module, vendorOpen);
+                } else if (patch(&module->init, &SamsungCameraModule::sInit)) {
+                    sVendorInit = vendorInit;
+                }
+            }
+        }
+    }
+
+    sCameraInfoStored = property_get_bool(kInfoStoreProp, false);
+    if (sCameraInfoStored) {
+        CameraInfoStore::load(sModule, &sCameraInfoCache);
+    }
+
+    return true;
+}
+
+void SamsungCameraModule::persist() {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    if (sCameraInfoStored && sCameraInfoDirty) {
+        CameraInfoStore::save(sModule, sCameraInfoCache);
+        sCameraInfoDirty = false;
+    }
+}
+
+/*
+ * Swap in resource costs and characteristics advertising what the provider
+ * adds on top of the blob. Only applied on the way out, the cache and store
+ * keep the vendor ones.
+ */
+static void advertiseLocked(int id, struct camera_info *info) {
+    OpenArbiter::advertise(id, info);
+
+    if (info->static_camera_characteristics == nullptr) {
+        return;
+    }
+
+    auto it = sAdvertisedCharacteristics.find(id);
+    if (it == sAdvertisedCharacteristics.end()) {
+        camera_metadata_t *advertised = nullptr;
+
+        // Only the HIDL 3.5 session asks for buffers, older devices keep getting them.
+        if (sHalBufferManagement && info->device_version >= CAMERA_DEVICE_API_VERSION_3_5) {
+            advertised = HalBufferManager::advertise(info->static_camera_characteristics);
+        }
+        // Applied on top of what was advertised so far.
+        if (camera_metadata_t *tighter = JpegSizeTracker::advertise(
+                    id, advertised != nullptr ? advertised : info->static_camera_characteristics)) {
+            free_camera_metadata(advertised);
+            advertised = tighter;
+        }
+
+        it = sAdvertisedCharacteristics.emplace(id, advertised).first;
+    }
+
+    if (it->second != nullptr) {
+        info->static_camera_characteristics = it->second;
+    }
+}
+
+int SamsungCameraModule::getCameraInfo(int id, struct camera_info *info) {
+    {
+        std::lock_guard<std::mutex> lock(sLock);
+
+        auto it = sCameraInfoCache.find(id);
+        if (it != sCameraInfoCache.end()) {
+            *info = it->second;
+            advertiseLocked(id, info);
+            return NO_ERROR;
+        }
+    }
+
+    // Call out without the lock held, so several IDs can be probed at once.
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    int rc = sVendorGetCameraInfo(id, info);
+    if (rc != NO_ERROR) {
+        return rc;
+    }
+    ProviderStats::time(id, ProviderStats::PROBE, systemTime(SYSTEM_TIME_MONOTONIC) - start);
+
+    std::lock_guard<std::mutex> lock(sLock);
+    sCameraInfoDirty |= sCameraInfoCache.emplace(id, *info).second;
+    advertiseLocked(id, info);
+    return NO_ERROR;
+}
+
+bool SamsungCameraModule::probe(const std::vector<int>& ids, size_t threads) {
+    if (!hook()) {
+        return false;
+    }
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < std::min(threads, ids.size()); t++) {
+        workers.emplace_back([&ids, &next] {
+            for (size_t n = next++; n < ids.size(); n = next++) {
+                struct camera_info info;
+                getCameraInfo(ids[n], &info);
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    return true;
+}
+
+/*
+ * CameraModule initializes the module before asking it about any camera,
+ * and only then may the prewarmer look for the back camera.
+ */
+int SamsungCameraModule::sInit() {
+    int rc = sVendorInit != nullptr ? sVendorInit() : NO_ERROR;
+
+    if (rc == NO_ERROR) {
+        CameraPrewarmer::start(sModule, sVendorOpen);
+    }
+
+    return rc;
+}
+
+int SamsungCameraModule::sGetCameraInfo(int id, struct camera_info *info) {
+    return getCameraInfo(id, info);
+}
+
+/*
+ * Nothing is locked around the vendor open, so different IDs open at once.
+ */
+int SamsungCameraModule::sOpen(const hw_module_t *module, const char *id, hw_device_t **device) {
+    int cameraId = atoi(id);
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    int rc = NO_ERROR;
+    // Claimed first, a camera opened ahead already holds its cost and gives it back if unused.
+    if (hw_device_t *prewarmed = CameraPrewarmer::claim(cameraId)) {
+        *device = prewarmed;
+    } else {
+        if (!OpenArbiter::acquire(cameraId)) {
+            // Maybe only until a camera being opened ahead is closed again.
+            CameraPrewarmer::settle();
+            if (!OpenArbiter::acquire(cameraId)) {
+                CameraPrewarmer::closed();
+                return -EUSERS;
+            }
+        }
+        rc = sVendorOpen(module, id, device);
+    }
+    if (rc != NO_ERROR) {
+        OpenArbiter::release(cameraId);
+        CameraPrewarmer::closed();
+        return rc;
+    }
+    nsecs_t duration = systemTime(SYSTEM_TIME_MONOTONIC) - start;
+    OpenArbiter::opened(cameraId, duration);
+    ProviderStats::time(cameraId, ProviderStats::OPEN, duration);
+
+    hw_device_t *vendorDevice = *device;
+    struct camera_info info;
+    if (SamsungCameraDevice::isEnabled() && getCameraInfo(cameraId, &info) == NO_ERROR) {
+        *device = SamsungCameraDevice::wrap(cameraId, info.static_camera_characteristics, *device);
+    }
+
+    // Closing is only seen through the wrapper, the cost goes right away without it.
+    if (*device == vendorDevice) {
+        OpenArbiter::release(cameraId);
+        CameraPrewarmer::closed();
+    }
+
+    return rc;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMSUNG_CAMERA_MODULE_H
+#define SAMSUNG_CAMERA_MODULE_H
+
+#include <vector>
+
+#include <hardware/camera_common.h>
+
+/*
+ * Hooks into the vendor camera_module_t.
+ *
+ * CameraModule serializes every getCameraInfo() behind one lock, so IDs can
+ * only be probed concurrently by calling the vendor module directly. Results
+ * are cached, and get_camera_info() of the module is redirected to the cache
+ * so CameraModule's own lookups don't ask the blob a second time.
+ *
+ * The cache can also be kept on disk through CameraInfoStore, in which case
+ * hook() has to run before LegacyCameraProviderImpl probes the module.
+ *
+ * If SamsungCameraDevice is enabled, open() is redirected as well so every
+ * opened device gets wrapped. Only then can the characteristics handed out
+ * advertise HAL buffer management, see HalBufferManager. Opens also go
+ * through OpenArbiter, whose resource costs are advertised in camera_info,
+ * and are handed the device CameraPrewarmer opened ahead if there is one,
+ * which init() is hooked for to start only once the module is initialized.
+ * A tighter JPEG max size can be advertised through JpegSizeTracker.
+ */
+class SamsungCameraModule {
+public:
+    /*
+     * Install the hooks. Safe to call more than once.
+     */
+    static bool hook();
+
+    /*
+     * Thread safe, served from the cache when possible.
+     */
+    static int getCameraInfo(int id, struct camera_info *info);
+
+    /*
+     * Ask the vendor module about several IDs at once on up to threads
+     * threads, to fill the cache. False if the module couldn't be hooked.
+     */
+    static bool probe(const std::vector<int>& ids, size_t threads);
+
+    /*
+     * Write the cache to disk if enabled and anything was probed live.
+     */
+    static void persist();
+
+private:
+    static int sInit();
+    static int sGetCameraInfo(int id, struct camera_info *info);
+    static int sOpen(const hw_module_t *module, const char *id, hw_device_t **device);
+};
+
+#endif // SAMSUNG_CAMERA_MODULE_H
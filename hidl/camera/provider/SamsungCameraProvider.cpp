@@ -18,60 +18,242 @@
 
 #include "SamsungCameraProvider.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cutils/properties.h>
+#include <utils/Timers.h>
+
+#include "ExtraIDs.h"
+#include "ProviderStats.h"
+#include "SamsungCameraModule.h"
 
+using ::android::Mutex;
 using ::android::NO_ERROR;
 using ::android::OK;
+using ::android::hardware::Void;
+using ::android::hardware::camera::common::V1_0::CameraDeviceStatus;
+using ::android::hardware::camera::provider::V2_4::Status;
 
 const int kMaxCameraIdLen = 16;
 
-SamsungCameraProvider::SamsungCameraProvider() : LegacyCameraProviderImpl_2_5() {
-#if !defined(EXYNOS9820_MODEL_beyond0lte) && !defined(EXYNOS9820_MODEL_f62)
-    // ID=52 is telephoto
-    mExtraIDs.push_back(52);
-#endif
+// Number of threads probing mExtraIDs at startup, serial if below 2.
+const char *kProbeThreadsProp = "ro.vendor.camera.provider.probe_threads";
 
-#if defined(EXYNOS9820_MODEL_beyond2lte) || defined(EXYNOS9820_MODEL_beyondx)
-    // ID=51 is the second front cam
-    mExtraIDs.push_back(51);
-#endif
+// Comma separated extra IDs, each optionally suffixed with ":lazy" to list it
+// unprobed and only probe it when its interface is first asked for.
+const char *kExtraIDsProp = "ro.vendor.camera.provider.extra_ids";
 
-#ifdef EXYNOS9820_MODEL_f62
-   // ID=52 is depth camera
-   mExtraIDs.push_back(52);
-  // ID=54 is macro
-   mExtraIDs.push_back(54);
-#endif
+// Used if kExtraIDsProp is unset.
+const std::map<std::string, std::string> kDefaultExtraIDs = {
+    // ID=52 is telephoto, ID=51 is the second front cam
+    {"beyond0lte", ""},
+    {"beyond2lte", "52,51"},
+    {"beyondx", "52,51"},
+    // ID=52 is depth camera, ID=54 is macro
+    {"f62", "52,54"},
+};
+const char *kDefaultExtraIDsFallback = "52";
+
+SamsungCameraProvider::SamsungCameraProvider() : LegacyCameraProviderImpl_2_5() {
+    loadExtraIDs();
 
     if (!mInitFailed) {
-        for (int i : mExtraIDs) {
-            struct camera_info info;
-            auto rc = mModule->getCameraInfo(i, &info);
+        for (const auto& [cameraId, status] : mCameraStatusMap) {
+            ProviderStats::exposed(atoi(cameraId.c_str()), false);
+        }
+
+        probeExtraIDsInParallel();
 
-            if (rc != NO_ERROR) {
-                continue;
+        for (int i : mExtraIDs) {
+            if (!addExtraID(i, false)) {
+                mModule.clear();
+                mInitFailed = true;
+                return;
             }
+        }
 
-            if (checkCameraVersion(i, info) != OK) {
-                ALOGE("Camera version check failed!");
+        for (int i : mLazyExtraIDs) {
+            if (!listLazyExtraID(i) && !addExtraID(i, false)) {
                 mModule.clear();
                 mInitFailed = true;
                 return;
             }
+        }
+    }
+}
+
+SamsungCameraProvider::~SamsungCameraProvider() {}
+
+Return<void> SamsungCameraProvider::getCameraDeviceInterface_V3_x(
+        const hidl_string& cameraDeviceName, getCameraDeviceInterface_V3_x_cb _hidl_cb) {
+    if (!probeLazyExtraID(cameraDeviceName.c_str())) {
+        _hidl_cb(Status::ILLEGAL_ARGUMENT, nullptr);
+        return Void();
+    }
+
+    return LegacyCameraProviderImpl_2_5::getCameraDeviceInterface_V3_x(cameraDeviceName, _hidl_cb);
+}
+
+/*
+ * Fill mExtraIDs and mLazyExtraIDs from kExtraIDsProp, or from the defaults
+ * for this device.
+ */
+void SamsungCameraProvider::loadExtraIDs() {
+    char value[PROPERTY_VALUE_MAX];
+
+    if (property_get(kExtraIDsProp, value, "") == 0) {
+        char device[PROPERTY_VALUE_MAX];
+        property_get("ro.product.vendor.device", device, "");
+
+        auto it = kDefaultExtraIDs.find(device);
+        snprintf(value, sizeof(value), "%s",
+                 it != kDefaultExtraIDs.end() ? it->second.c_str() : kDefaultExtraIDsFallback);
+    }
+
+    parseExtraIDs(value, &mExtraIDs, &mLazyExtraIDs);
+}
+
+/*
+ * Probe an extra ID and expose it, announcing it to the framework if asked
+ * to. Returns false if the module reports a version we can't handle.
+ */
+bool SamsungCameraProvider::addExtraID(int id, bool announce) {
+    struct camera_info info;
+    auto rc = mModule->getCameraInfo(id, &info);
+
+    if (rc != NO_ERROR) {
+        return true;
+    }
+
+    if (checkCameraVersion(id, info) != OK) {
+        ALOGE("Camera version check failed!");
+        return false;
+    }
 
 #ifdef SAMSUNG_CAMERA_DEBUG
-            ALOGI("ID=%d is at index %d", i, mNumberOfLegacyCameras);
+    ALOGI("ID=%d is at index %d", id, mNumberOfLegacyCameras);
 #endif
 
-            char cameraId[kMaxCameraIdLen];
-            snprintf(cameraId, sizeof(cameraId), "%d", i);
-            std::string cameraIdStr(cameraId);
-            mCameraStatusMap[cameraIdStr] = CAMERA_DEVICE_STATUS_PRESENT;
+    char cameraId[kMaxCameraIdLen];
+    snprintf(cameraId, sizeof(cameraId), "%d", id);
+    std::string cameraIdStr(cameraId);
+    mCameraStatusMap[cameraIdStr] = CAMERA_DEVICE_STATUS_PRESENT;
 
-            addDeviceNames(i);
-            mNumberOfLegacyCameras++;
+    addDeviceNames(id, CameraDeviceStatus::PRESENT, announce);
+    mNumberOfLegacyCameras++;
+    ProviderStats::exposed(id, true);
+    return true;
+}
+
+/*
+ * List a lazy ID without asking the module about it, under the device
+ * version of an ID probed already. All of it happens in the constructor,
+ * before the framework can see any of the lists. Returns false if there is
+ * no probed ID to take the version from.
+ */
+bool SamsungCameraProvider::listLazyExtraID(int id) {
+    if (mLazyTemplateID < 0) {
+        if (mCameraDeviceNames.isEmpty()) {
+            return false;
         }
+
+        const auto& [templateId, templateName] = mCameraDeviceNames[0];
+        mLazyTemplateID = atoi(templateId.c_str());
+        // "device@3.x/legacy/", of that ID's device version.
+        mLazyDeviceNamePrefix = templateName.substr(0, templateName.rfind('/') + 1);
     }
+
+    std::string cameraId = std::to_string(id);
+    std::string deviceName = mLazyDeviceNamePrefix + cameraId;
+
+#ifdef SAMSUNG_CAMERA_DEBUG
+    ALOGI("ID=%d is at index %d, listed as %s until probed", id, mNumberOfLegacyCameras,
+          deviceName.c_str());
+#endif
+
+    mUnprobedLazyExtraIDs[deviceName] = id;
+    mCameraIds.add(cameraId);
+    mCameraDeviceNames.add(std::make_pair(cameraId, deviceName));
+    mCameraStatusMap[cameraId] = CAMERA_DEVICE_STATUS_PRESENT;
+    mNumberOfLegacyCameras++;
+    ProviderStats::exposed(id, true);
+    return true;
 }
 
-SamsungCameraProvider::~SamsungCameraProvider() {}
+/*
+ * Probe a lazy ID the first time its interface is asked for. Returns false,
+ * and takes the ID off the list, if the module doesn't know it or it isn't
+ * of the device version it was listed under.
+ *
+ * cameraserver asks for the interface of every listed device as it starts,
+ * so this doesn't spare the blob any probing, it moves it off the path to
+ * registering the provider and onto cameraserver's own startup.
+ */
+bool SamsungCameraProvider::probeLazyExtraID(const std::string& deviceName) {
+    // Held while probing, so a second caller for the same ID waits for it.
+    std::lock_guard<std::mutex> lock(mLazyExtraIDsLock);
+
+    auto it = mUnprobedLazyExtraIDs.find(deviceName);
+    if (it == mUnprobedLazyExtraIDs.end()) {
+        return true;
+    }
+
+    int id = it->second;
+    mUnprobedLazyExtraIDs.erase(it);
+
+    struct camera_info info;
+    if (mModule->getCameraInfo(id, &info) == NO_ERROR && checkCameraVersion(id, info) == OK &&
+            mModule->getDeviceVersion(id) == mModule->getDeviceVersion(mLazyTemplateID)) {
+        return true;
+    }
+
+    ALOGE("Lazy ID=%d isn't a camera like ID=%d, taking it off the list", id, mLazyTemplateID);
+
+    // Like the base class does for a camera that goes away. No callback, the
+    // framework learns it from the failed call it is making.
+    Mutex::Autolock _l(mCbLock);
+    mCameraStatusMap[std::to_string(id)] = CAMERA_DEVICE_STATUS_NOT_PRESENT;
+    return false;
+}
+
+/*
+ * Ask the vendor module about all extra IDs at once. The serial loop in the
+ * constructor then picks the results up from SamsungCameraModule's cache,
+ * so IDs are still added in the same order.
+ */
+void SamsungCameraProvider::probeExtraIDsInParallel() {
+    size_t threads = std::min<size_t>(std::max(property_get_int32(kProbeThreadsProp, 0), 0),
+                                      mExtraIDs.size());
+
+    if (threads < 2) {
+        return;
+    }
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (!SamsungCameraModule::probe(mExtraIDs, threads)) {
+        return;
+    }
+
+#ifdef SAMSUNG_CAMERA_DEBUG
+    ALOGI("Probed %zu extra IDs on %zu threads in %lld ms", mExtraIDs.size(), threads,
+          static_cast<long long>((systemTime(SYSTEM_TIME_MONOTONIC) - start) / 1000000));
+#else
+    (void)start;
+#endif
+}
+
+Return<void> SamsungCameraProviderService::debug(const hidl_handle& fd,
+                                                 const hidl_vec<hidl_string>& /* options */) {
+    if (fd.getNativeHandle() == nullptr || fd->numFds < 1) {
+        return Void();
+    }
+
+    ProviderStats::dump(fd->data[0]);
+    return Void();
+}
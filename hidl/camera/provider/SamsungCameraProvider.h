@@ -15,21 +15,61 @@
  */
 
 #ifndef SAMSUNG_CAMERA_PROVIDER_H
+#define SAMSUNG_CAMERA_PROVIDER_H
 
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "CameraProvider_2_5.h"
 #include "LegacyCameraProviderImpl_2_5.h"
 
 #define SAMSUNG_CAMERA_DEBUG
 
+using ::android::hardware::camera::provider::V2_5::implementation::CameraProvider;
 using ::android::hardware::camera::provider::V2_5::implementation::LegacyCameraProviderImpl_2_5;
+using ::android::hardware::hidl_handle;
+using ::android::hardware::hidl_string;
+using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 
 class SamsungCameraProvider : public LegacyCameraProviderImpl_2_5 {
 public:
+    using getCameraDeviceInterface_V3_x_cb = ::android::hardware::camera::provider::V2_4::
+            ICameraProvider::getCameraDeviceInterface_V3_x_cb;
+
     SamsungCameraProvider();
     ~SamsungCameraProvider();
 
+    // Hides the base version, CameraProvider<> calls it on the IMPL type.
+    Return<void> getCameraDeviceInterface_V3_x(const hidl_string& cameraDeviceName,
+                                               getCameraDeviceInterface_V3_x_cb _hidl_cb);
+
 private:
+    void loadExtraIDs();
+    bool addExtraID(int id, bool announce);
+    void probeExtraIDsInParallel();
+    bool listLazyExtraID(int id);
+    bool probeLazyExtraID(const std::string& deviceName);
+
     std::vector<int> mExtraIDs;
+    std::vector<int> mLazyExtraIDs;
+    // Device names of the lazy IDs listed but not probed yet.
+    std::map<std::string, int> mUnprobedLazyExtraIDs;
+    std::mutex mLazyExtraIDsLock;
+    // A probed ID, lazy IDs are listed under its device version.
+    int mLazyTemplateID = -1;
+    std::string mLazyDeviceNamePrefix;
+};
+
+/*
+ * The provider as registered. CameraProvider<> only forwards the
+ * ICameraProvider methods to its implementation, so debug() is added here
+ * and prints the counters of ProviderStats.
+ */
+class SamsungCameraProviderService : public CameraProvider<SamsungCameraProvider> {
+public:
+    Return<void> debug(const hidl_handle& fd, const hidl_vec<hidl_string>& options) override;
 };
 
 #endif // SAMSUNG_CAMERA_PROVIDER_H
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SettingsCache"
+
+#include "SettingsCache.h"
+
+#include <string.h>
+
+#include <cutils/properties.h>
+
+// Replace settings identical to the last ones by NULL before they reach the blob.
+const char *kSettingsCacheProp = "ro.vendor.camera.provider.settings_cache";
+
+static bool hasTrigger(const camera_metadata_t *settings) {
+    camera_metadata_ro_entry_t entry;
+
+    if (find_camera_metadata_ro_entry(settings, ANDROID_CONTROL_AF_TRIGGER, &entry) == 0 &&
+            entry.count == 1 && entry.data.u8[0] != ANDROID_CONTROL_AF_TRIGGER_IDLE) {
+        return true;
+    }
+
+    return find_camera_metadata_ro_entry(settings, ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER,
+                                         &entry) == 0 &&
+            entry.count == 1 && entry.data.u8[0] != ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER_IDLE;
+}
+
+bool SettingsCache::isEnabled() {
+    static bool enabled = property_get_bool(kSettingsCacheProp, false);
+
+    return enabled;
+}
+
+SettingsCache::SettingsCache() : mValid(false), mNumForwarded(0), mNumElided(0) {}
+
+const camera_metadata_t *SettingsCache::filter(const camera3_capture_request_t *request) {
+    const camera_metadata_t *settings = request->settings;
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (settings == nullptr) {
+        return nullptr;
+    }
+
+    size_t size = get_camera_metadata_size(settings);
+    if (mValid && request->input_buffer == nullptr && size == mLast.size() &&
+            memcmp(settings, mLast.data(), size) == 0 && !hasTrigger(settings)) {
+        mNumElided++;
+        return nullptr;
+    }
+
+    auto *data = reinterpret_cast<const uint8_t *>(settings);
+    mLast.assign(data, data + size);
+    mValid = true;
+    mNumForwarded++;
+
+    return settings;
+}
+
+void SettingsCache::reset() {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mValid = false;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SETTINGS_CACHE_H
+#define SETTINGS_CACHE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <hardware/camera3.h>
+
+/*
+ * Remembers the last settings handed to the vendor device.
+ *
+ * NULL settings in a capture request mean "same as the last request", but
+ * the framework only sends NULL when it repeats the very same request. A
+ * repeating request that gets rebuilt, or two requests alternating with the
+ * same settings, make the blob parse the full buffer again every frame.
+ * Settings identical to the last ones forwarded are replaced by NULL.
+ *
+ * Reprocess requests and requests carrying an AF or precapture trigger are
+ * always forwarded, so neither is mistaken for a repeat of the last one.
+ */
+class SettingsCache {
+public:
+    static bool isEnabled();
+
+    SettingsCache();
+
+    /*
+     * The settings to hand to the vendor device in place of the request's.
+     */
+    const camera_metadata_t *filter(const camera3_capture_request_t *request);
+
+    /*
+     * Forget the last settings, the next ones will be forwarded. Needed
+     * whenever the device may not have applied them.
+     */
+    void reset();
+
+    uint32_t numForwarded() const { return mNumForwarded; }
+    uint32_t numElided() const { return mNumElided; }
+
+private:
+    std::mutex mLock;
+    std::vector<uint8_t> mLast;
+    bool mValid;
+    std::atomic<uint32_t> mNumForwarded;
+    std::atomic<uint32_t> mNumElided;
+};
+
+#endif // SETTINGS_CACHE_H
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "InflightRing.h"
+
+// About what the device keeps per frame in flight.
+struct Frame {
+    uint32_t pendingBuffers;
+    uint32_t partialResults;
+    std::vector<int> releaseFences;
+};
+
+// Lookups per frame, one per partial result and buffer callback.
+const int kFindsPerFrame = 4;
+
+struct MapFrames {
+    std::map<uint32_t, Frame> frames;
+
+    explicit MapFrames(uint32_t) {}
+    Frame *insert(uint32_t frameNumber) { return &frames[frameNumber]; }
+    Frame *find(uint32_t frameNumber) {
+        auto it = frames.find(frameNumber);
+        return it == frames.end() ? nullptr : &it->second;
+    }
+    void erase(uint32_t frameNumber) { frames.erase(frameNumber); }
+};
+
+struct RingFrames {
+    InflightRing<Frame> frames;
+
+    explicit RingFrames(uint32_t depth) : frames(depth) {}
+    Frame *insert(uint32_t frameNumber) { return frames.insert(frameNumber); }
+    Frame *find(uint32_t frameNumber) { return frames.find(frameNumber); }
+    void erase(uint32_t frameNumber) { frames.erase(frameNumber); }
+};
+
+/*
+ * Keep depth frames in flight: per frame, start the next one, look up every
+ * frame in flight a few times like its callbacks would, and finish the
+ * oldest.
+ */
+template <typename Frames>
+static void BM_Inflight(benchmark::State& state) {
+    uint32_t depth = state.range(0);
+    Frames frames(depth);
+    uint32_t frameNumber = 0;
+
+    for (; frameNumber < depth - 1; frameNumber++) {
+        frames.insert(frameNumber)->pendingBuffers = 2;
+    }
+
+    for (auto _ : state) {
+        Frame *frame = frames.insert(frameNumber);
+        frame->pendingBuffers = 2;
+        frame->partialResults = 0;
+
+        for (int n = 0; n < kFindsPerFrame; n++) {
+            for (uint32_t age = 0; age < depth; age++) {
+                Frame *inflight = frames.find(frameNumber - age);
+                benchmark::DoNotOptimize(inflight);
+                inflight->partialResults++;
+            }
+        }
+
+        frames.erase(frameNumber - (depth - 1));
+        frameNumber++;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Inflight, MapFrames)->ArgName("depth")->RangeMultiplier(2)->Range(4, 64);
+BENCHMARK_TEMPLATE(BM_Inflight, RingFrames)->ArgName("depth")->RangeMultiplier(2)->Range(4, 64);
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <hardware/camera_common.h>
+
+#include "SamsungCameraModule.h"
+
+// How long the fake module takes per ID, the blob takes hundreds of ms.
+static std::atomic<int> sProbeUs(20000);
+
+static int fakeGetNumberOfCameras() {
+    return 4;
+}
+
+static int fakeGetCameraInfo(int /* id */, struct camera_info *info) {
+    usleep(sProbeUs);
+
+    memset(info, 0, sizeof(*info));
+    info->facing = CAMERA_FACING_BACK;
+    info->device_version = CAMERA_DEVICE_API_VERSION_3_5;
+    info->resource_cost = 50;
+    return 0;
+}
+
+static hw_module_methods_t sFakeMethods;
+
+/*
+ * Stands in for camera.exynos9820, handed to SamsungCameraModule by the
+ * hw_get_module() below.
+ */
+static camera_module_t sFakeModule = {
+    .common = {
+        .tag = HARDWARE_MODULE_TAG,
+        .module_api_version = CAMERA_MODULE_API_VERSION_2_5,
+        .hal_api_version = HARDWARE_HAL_API_VERSION,
+        .id = CAMERA_HARDWARE_MODULE_ID,
+        .name = "Fake camera module",
+        .methods = &sFakeMethods,
+    },
+    .get_number_of_cameras = fakeGetNumberOfCameras,
+    .get_camera_info = fakeGetCameraInfo,
+};
+
+extern "C" int hw_get_module(const char * /* id */, const struct hw_module_t **module) {
+    *module = &sFakeModule.common;
+    return 0;
+}
+
+/*
+ * Probe as many extra IDs as there are on the device on the given number
+ * of threads, one being the serial loop it replaces. Every iteration asks
+ * about IDs never seen before, the module caches whatever it probed.
+ */
+static void BM_ProbeExtraIDs(benchmark::State& state) {
+    static int sNextId = 100;
+    size_t numIds = state.range(0);
+    size_t threads = state.range(1);
+
+    sProbeUs = state.range(2);
+    for (auto _ : state) {
+        std::vector<int> ids;
+        for (size_t n = 0; n < numIds; n++) {
+            ids.push_back(sNextId++);
+        }
+
+        SamsungCameraModule::probe(ids, threads);
+    }
+
+    state.SetItemsProcessed(state.iterations() * numIds);
+}
+BENCHMARK(BM_ProbeExtraIDs)
+        ->ArgNames({"ids", "threads", "probe_us"})
+        ->ArgsProduct({{3, 8}, {1, 2, 4}, {20000}})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <system/camera_metadata.h>
+#include <system/graphics.h>
+
+#include "SamsungCameraDevice.h"
+#include "replay/FakeDevice.h"
+#include "replay/FakeProperties.h"
+
+// Like the framework, which stops sending once the HAL has its pipeline full.
+const uint32_t kMaxInflight = 8;
+
+/*
+ * The framework side, timing each frame from its request to the result
+ * carrying its buffers.
+ */
+struct Framework : public camera3_callback_ops_t {
+    std::mutex lock;
+    std::condition_variable condition;
+    std::map<uint32_t, nsecs_t> pending;
+    std::vector<nsecs_t> resultLatencyNs;
+    size_t numErrors = 0;
+
+    Framework() {
+        memset(static_cast<camera3_callback_ops_t *>(this), 0, sizeof(camera3_callback_ops_t));
+        process_capture_result = sProcessCaptureResult;
+        notify = sNotify;
+    }
+
+    void requested(uint32_t frameNumber, nsecs_t now) {
+        std::lock_guard<std::mutex> l(lock);
+        pending[frameNumber] = now;
+    }
+
+    bool waitForPending(size_t maxPending) {
+        std::unique_lock<std::mutex> l(lock);
+        return condition.wait_for(l, std::chrono::seconds(5),
+                                  [&] { return pending.size() <= maxPending; });
+    }
+
+    static Framework *from(const camera3_callback_ops_t *ops) {
+        return static_cast<Framework *>(const_cast<camera3_callback_ops_t *>(ops));
+    }
+
+    static void sProcessCaptureResult(const camera3_callback_ops_t *ops,
+                                      const camera3_capture_result_t *result) {
+        if (result->num_output_buffers == 0) {
+            return;
+        }
+
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        Framework *self = from(ops);
+        std::lock_guard<std::mutex> l(self->lock);
+
+        auto it = self->pending.find(result->frame_number);
+        if (it != self->pending.end()) {
+            self->resultLatencyNs.push_back(now - it->second);
+            self->pending.erase(it);
+            self->condition.notify_all();
+        }
+    }
+
+    static void sNotify(const camera3_callback_ops_t *ops, const camera3_notify_msg_t *msg) {
+        if (msg->type == CAMERA3_MSG_ERROR) {
+            Framework *self = from(ops);
+            std::lock_guard<std::mutex> l(self->lock);
+            self->numErrors++;
+        }
+    }
+};
+
+/*
+ * Stream a second worth of frames per iteration at the given frame rate
+ * through SamsungCameraDevice, with a FakeDevice standing in for the blob
+ * and every feature on the request and result paths turned on. Reports the
+ * request rate that was kept up and the result latency, from the request
+ * to the buffers coming back.
+ */
+static void BM_Throughput(benchmark::State& state) {
+    uint32_t fps = state.range(0);
+
+    setPerFrameFeatureProperties();
+
+    FakeDeviceConfig config;
+    config.partialResultCount = state.range(1);
+    config.errorRequestPerMille = state.range(2);
+    config.errorResultPerMille = state.range(2);
+    config.errorBufferPerMille = state.range(2);
+
+    FakeDevice fake(config);
+    auto *device = reinterpret_cast<camera3_device_t *>(
+            SamsungCameraDevice::wrap(0, fake.characteristics(), fake.device()));
+    Framework framework;
+    device->ops->initialize(device, &framework);
+
+    camera3_stream_t preview = {}, video = {};
+    preview.stream_type = video.stream_type = CAMERA3_STREAM_OUTPUT;
+    preview.width = video.width = 1920;
+    preview.height = video.height = 1080;
+    preview.format = video.format = HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED;
+    preview.max_buffers = video.max_buffers = kMaxInflight;
+    camera3_stream_t *streams[] = {&preview, &video};
+
+    camera3_stream_configuration_t streamList = {};
+    streamList.num_streams = 2;
+    streamList.streams = streams;
+    streamList.operation_mode = CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE;
+    device->ops->configure_streams(device, &streamList);
+
+    static native_handle_t buffer;
+    static buffer_handle_t handle = &buffer;
+    std::vector<camera3_stream_buffer_t> outputBuffers;
+    for (camera3_stream_t *stream : streams) {
+        outputBuffers.push_back({stream, &handle, CAMERA3_BUFFER_STATUS_OK, -1, -1});
+    }
+
+    camera_metadata_t *settings = allocate_camera_metadata(0, 0);
+    nsecs_t intervalNs = s2ns(1) / fps;
+    uint32_t frameNumber = 0;
+
+    for (auto _ : state) {
+        nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+
+        for (uint32_t n = 0; n < fps; n++, frameNumber++) {
+            nsecs_t dueNs = startNs + intervalNs * n;
+            nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+            if (dueNs > now) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(dueNs - now));
+            }
+
+            framework.waitForPending(kMaxInflight - 1);
+
+            camera3_capture_request_t request = {};
+            request.frame_number = frameNumber;
+            request.settings = frameNumber == 0 ? settings : nullptr;
+            request.num_output_buffers = outputBuffers.size();
+            request.output_buffers = outputBuffers.data();
+
+            framework.requested(frameNumber, systemTime(SYSTEM_TIME_MONOTONIC));
+            device->ops->process_capture_request(device, &request);
+        }
+
+        if (!framework.waitForPending(0)) {
+            state.SkipWithError("Frames still pending");
+            break;
+        }
+    }
+
+    fake.stop();
+    device->common.close(&device->common);
+    free_camera_metadata(settings);
+
+    std::vector<nsecs_t>& latencies = framework.resultLatencyNs;
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty()) {
+        state.counters["p50_ms"] = latencies[latencies.size() / 2] / 1e6;
+        state.counters["p99_ms"] = latencies[latencies.size() * 99 / 100] / 1e6;
+        state.counters["max_ms"] = latencies.back() / 1e6;
+    }
+    state.counters["errors"] = framework.numErrors;
+    state.counters["requests"] =
+            benchmark::Counter(frameNumber, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Throughput)
+        ->ArgNames({"fps", "partials", "errors_per_mille"})
+        ->ArgsProduct({{30, 60, 120, 240}, {1, 3}, {0}})
+        ->Args({240, 3, 10})
+        ->Iterations(2)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
@@ -0,0 +1,630 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Drives SamsungCameraDevice on the host, with a stub camera3_device
+ * standing in for the vendor HAL underneath it.
+ *
+ * Given a capture trace recorded by CaptureRecorder, the stub sends back
+ * the recorded notifies and results with their recorded delay after each
+ * request, and the requests are fed to the wrapper at their recorded
+ * times. This measures what the provider itself adds on the request and
+ * callback paths.
+ *
+ * With -f, a FakeDevice answers instead and requests are sent at each of
+ * the given frame rates, to measure throughput and result latency with
+ * any stream set, partial result count, stage latencies and errors, in
+ * normal or, with -H, constrained high speed mode. With -B, requests come
+ * without buffers and the device has to ask for them. With -F, the device
+ * is flushed right after the last request, with its flush taking as long
+ * as given.
+ *
+ * Every feature on the request and result paths is turned on, see
+ * setPerFrameFeatureProperties(). With -b, none are, to measure the bare
+ * wrapper, and -P sets any provider property on top.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <hardware/camera3.h>
+#include <utils/Timers.h>
+
+#include "FakeDevice.h"
+#include "FakeProperties.h"
+#include "SamsungCameraDevice.h"
+#include "TraceDevice.h"
+
+static void printStats(const char *name, std::vector<nsecs_t> values) {
+    if (values.empty()) {
+        printf("%s: no samples\n", name);
+        return;
+    }
+
+    std::sort(values.begin(), values.end());
+
+    nsecs_t sum = 0;
+    for (nsecs_t value : values) {
+        sum += value;
+    }
+
+    printf("%s: n=%zu avg=%.1fus p50=%.1fus p99=%.1fus max=%.1fus\n", name, values.size(),
+           static_cast<double>(sum) / values.size() / 1e3, values[values.size() / 2] / 1e3,
+           values[values.size() * 99 / 100] / 1e3, values.back() / 1e3);
+}
+
+/*
+ * The framework side, receiving what the wrapper forwards.
+ */
+struct Framework : public camera3_callback_ops_t {
+    StubDevice *stub;
+    std::mutex lock;
+    std::condition_variable condition;
+    std::vector<nsecs_t> callbackNs;
+    size_t numDelivered = 0;
+    size_t numErrors = 0;
+    // Frames whose buffers haven't come back yet, and when they were requested.
+    std::map<uint32_t, nsecs_t> pending;
+    std::vector<nsecs_t> resultLatencyNs;
+    // Buffers handed out through request_stream_buffers and not back yet.
+    std::map<const camera3_stream_t *, uint32_t> buffersOut;
+    uint32_t maxBuffersOut = 0;
+
+    explicit Framework(StubDevice *stub) : stub(stub) {
+        memset(static_cast<camera3_callback_ops_t *>(this), 0, sizeof(camera3_callback_ops_t));
+        process_capture_result = sProcessCaptureResult;
+        notify = sNotify;
+    }
+
+    /*
+     * Send requests without buffers and hand them out on demand, up to
+     * max_buffers of each stream.
+     */
+    void manageBuffers() { request_stream_buffers = sRequestStreamBuffers; }
+
+    camera3_buffer_request_status_t handOut(uint32_t numBufferReqs,
+                                            const camera3_buffer_request_t *bufferReqs,
+                                            uint32_t *numReturnedBufReqs,
+                                            camera3_stream_buffer_ret_t *returnedBufReqs) {
+        static native_handle_t buffer;
+        static buffer_handle_t handle = &buffer;
+        camera3_buffer_request_status_t status = CAMERA3_BUF_REQ_OK;
+        std::lock_guard<std::mutex> l(lock);
+
+        for (uint32_t i = 0; i < numBufferReqs; i++) {
+            camera3_stream_t *stream = bufferReqs[i].stream;
+            camera3_stream_buffer_ret_t& ret = returnedBufReqs[i];
+            uint32_t& out = buffersOut[stream];
+
+            ret.stream = stream;
+            if (out + bufferReqs[i].num_buffers_requested > stream->max_buffers) {
+                ret.status = CAMERA3_PS_BUF_REQ_MAX_BUFFER_EXCEEDED;
+                ret.num_output_buffers = 0;
+                status = CAMERA3_BUF_REQ_FAILED_PARTIAL;
+                continue;
+            }
+
+            ret.status = CAMERA3_PS_BUF_REQ_OK;
+            ret.num_output_buffers = bufferReqs[i].num_buffers_requested;
+            for (uint32_t j = 0; j < ret.num_output_buffers; j++) {
+                ret.output_buffers[j] = {stream, &handle, CAMERA3_BUFFER_STATUS_OK, -1, -1};
+            }
+            out += ret.num_output_buffers;
+            maxBuffersOut = std::max(maxBuffersOut, out);
+        }
+
+        *numReturnedBufReqs = numBufferReqs;
+        return status;
+    }
+
+    void requested(uint32_t frameNumber, nsecs_t now) {
+        std::lock_guard<std::mutex> l(lock);
+        pending[frameNumber] = now;
+    }
+
+    void delivered(const camera3_capture_result_t *result, const camera3_notify_msg_t *msg) {
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        std::lock_guard<std::mutex> l(lock);
+
+        callbackNs.push_back(now - stub->callbackStartNs);
+        numDelivered++;
+
+        for (uint32_t i = 0; result != nullptr && i < result->num_output_buffers; i++) {
+            const camera3_stream_buffer_t& buffer = result->output_buffers[i];
+            auto it = buffersOut.find(buffer.stream);
+
+            if (it != buffersOut.end() && it->second > 0 && *buffer.buffer != nullptr) {
+                it->second--;
+            }
+        }
+
+        if (msg != nullptr && msg->type == CAMERA3_MSG_ERROR) {
+            numErrors++;
+        } else if (result != nullptr && result->num_output_buffers > 0) {
+            auto it = pending.find(result->frame_number);
+            if (it != pending.end()) {
+                resultLatencyNs.push_back(now - it->second);
+                pending.erase(it);
+            }
+        }
+
+        condition.notify_all();
+    }
+
+    bool waitFor(size_t numExpected, nsecs_t timeoutNs) {
+        std::unique_lock<std::mutex> l(lock);
+        return condition.wait_for(l, std::chrono::nanoseconds(timeoutNs),
+                                  [&] { return numDelivered >= numExpected; });
+    }
+
+    bool waitForPending(size_t maxPending, nsecs_t timeoutNs) {
+        std::unique_lock<std::mutex> l(lock);
+        return condition.wait_for(l, std::chrono::nanoseconds(timeoutNs),
+                                  [&] { return pending.size() <= maxPending; });
+    }
+
+    static Framework *from(const camera3_callback_ops_t *ops) {
+        return static_cast<Framework *>(const_cast<camera3_callback_ops_t *>(ops));
+    }
+
+    static void sProcessCaptureResult(const camera3_callback_ops_t *ops,
+                                      const camera3_capture_result_t *result) {
+        from(ops)->delivered(result, nullptr);
+    }
+
+    static void sNotify(const camera3_callback_ops_t *ops, const camera3_notify_msg_t *msg) {
+        from(ops)->delivered(nullptr, msg);
+    }
+
+    static camera3_buffer_request_status_t sRequestStreamBuffers(
+            const camera3_callback_ops_t *ops, uint32_t numBufferReqs,
+            const camera3_buffer_request_t *bufferReqs, uint32_t *numReturnedBufReqs,
+            camera3_stream_buffer_ret_t *returnedBufReqs) {
+        return from(ops)->handOut(numBufferReqs, bufferReqs, numReturnedBufReqs,
+                                  returnedBufReqs);
+    }
+};
+
+static int replayTrace(const char *path, double speed, bool dump) {
+    Trace trace;
+    if (!loadTrace(path, &trace)) {
+        return 1;
+    }
+
+    TraceDevice stub(trace, speed);
+    auto *device = reinterpret_cast<camera3_device_t *>(
+            SamsungCameraDevice::wrap(trace.header->cameraId, trace.characteristics,
+                                      stub.device()));
+
+    Framework framework(&stub);
+    device->ops->initialize(device, &framework);
+
+    std::deque<std::vector<camera3_stream_t>> configs;
+    std::vector<camera3_stream_t *> streams;
+    std::vector<nsecs_t> requestNs;
+    std::map<uint32_t, size_t> frameEvents;
+    size_t numExpected = 0, numRequests = 0;
+    nsecs_t firstRecordNs = trace.records.empty() ? 0 : trace.records.front()->timestampNs;
+    nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    for (const CaptureTraceRecord *record : trace.records) {
+        if (record->type == CAPTURE_RECORD_NOTIFY) {
+            frameEvents[tracePayload<CaptureTraceNotify>(record)->frameNumber]++;
+        } else if (record->type == CAPTURE_RECORD_RESULT) {
+            frameEvents[tracePayload<CaptureTraceResult>(record)->frameNumber]++;
+        }
+    }
+
+    for (const CaptureTraceRecord *record : trace.records) {
+        if (record->type != CAPTURE_RECORD_CONFIGURE && record->type != CAPTURE_RECORD_REQUEST) {
+            continue;
+        }
+
+        nsecs_t dueNs = startNs + (record->timestampNs - firstRecordNs) / speed;
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (dueNs > now) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(dueNs - now));
+        }
+
+        if (record->type == CAPTURE_RECORD_CONFIGURE) {
+            const CaptureTraceConfigure *recorded = tracePayload<CaptureTraceConfigure>(record);
+            auto *recordedStreams = reinterpret_cast<const CaptureTraceStream *>(recorded + 1);
+
+            // Like the framework, only reconfigure an idle device.
+            framework.waitFor(numExpected, s2ns(5));
+
+            configs.emplace_back(recorded->numStreams);
+            streams.clear();
+            for (uint32_t i = 0; i < recorded->numStreams; i++) {
+                camera3_stream_t& stream = configs.back()[i];
+
+                memset(&stream, 0, sizeof(stream));
+                stream.stream_type = recordedStreams[i].streamType;
+                stream.width = recordedStreams[i].width;
+                stream.height = recordedStreams[i].height;
+                stream.format = recordedStreams[i].format;
+                stream.usage = recordedStreams[i].usage;
+                stream.max_buffers = recordedStreams[i].maxBuffers;
+                stream.data_space = static_cast<android_dataspace_t>(recordedStreams[i].dataSpace);
+                stream.rotation = recordedStreams[i].rotation;
+                streams.push_back(&stream);
+            }
+
+            camera3_stream_configuration_t streamList;
+            memset(&streamList, 0, sizeof(streamList));
+            streamList.num_streams = streams.size();
+            streamList.streams = streams.data();
+            streamList.operation_mode = recorded->operationMode;
+            device->ops->configure_streams(device, &streamList);
+            continue;
+        }
+
+        const CaptureTraceRequest *recorded = tracePayload<CaptureTraceRequest>(record);
+        auto *bufferRecords = reinterpret_cast<const CaptureTraceBuffer *>(recorded + 1);
+        std::vector<camera3_stream_buffer_t> outputBuffers;
+        camera3_stream_buffer_t inputBuffer;
+        static buffer_handle_t handle = nullptr;
+
+        for (uint32_t i = 0; i < recorded->numOutputBuffers; i++) {
+            int32_t index = bufferRecords[i].stream;
+            outputBuffers.push_back({
+                .stream = index >= 0 && static_cast<size_t>(index) < streams.size() ?
+                        streams[index] : nullptr,
+                .buffer = &handle,
+                .status = CAMERA3_BUFFER_STATUS_OK,
+                .acquire_fence = -1,
+                .release_fence = -1,
+            });
+        }
+
+        camera3_capture_request_t request;
+        memset(&request, 0, sizeof(request));
+        request.frame_number = recorded->frameNumber;
+        request.settings = traceMetadata(bufferRecords + recorded->numOutputBuffers,
+                                         recorded->settingsSize);
+        request.num_output_buffers = outputBuffers.size();
+        request.output_buffers = outputBuffers.data();
+        if (recorded->inputStream >= 0 && static_cast<size_t>(recorded->inputStream) < streams.size()) {
+            inputBuffer = {streams[recorded->inputStream], &handle, CAMERA3_BUFFER_STATUS_OK, -1, -1};
+            request.input_buffer = &inputBuffer;
+        }
+
+        numExpected += frameEvents[recorded->frameNumber];
+        numRequests++;
+
+        nsecs_t callNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        device->ops->process_capture_request(device, &request);
+        requestNs.push_back(callNs);
+    }
+
+    if (!framework.waitFor(numExpected, s2ns(5))) {
+        fprintf(stderr, "Timed out, %zu of %zu callbacks delivered\n", framework.numDelivered,
+                numExpected);
+    }
+
+    printf("Replayed %zu requests and %zu callbacks at %.2fx in %.1fms\n", numRequests,
+           framework.numDelivered, speed,
+           (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) / 1e6);
+
+    std::vector<nsecs_t> requestOverheadNs;
+    for (size_t i = 0; i < requestNs.size() && i < stub.requestEntryNs.size(); i++) {
+        requestOverheadNs.push_back(stub.requestEntryNs[i] - requestNs[i]);
+    }
+    printStats("Request path overhead", requestOverheadNs);
+    {
+        std::lock_guard<std::mutex> lock(framework.lock);
+        printStats("Callback path overhead", framework.callbackNs);
+    }
+    printStats("Stub callback lateness", stub.latenessNs);
+
+    fflush(stdout);
+    if (dump) {
+        device->ops->dump(device, STDOUT_FILENO);
+    }
+    stub.stop();
+    device->common.close(&device->common);
+    stub.waitForClose();
+
+    return 0;
+}
+
+struct SyntheticRun {
+    FakeDeviceConfig config;
+    std::vector<camera3_stream_t> streams;
+    uint32_t numFrames = 300;
+    uint32_t maxInflight = 8;
+    uint32_t operationMode = CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE;
+    bool manageBuffers = false;
+    bool flush = false;
+    bool dump = false;
+};
+
+static void runSynthetic(SyntheticRun& run, uint32_t fps) {
+    FakeDevice fake(run.config);
+    auto *device = reinterpret_cast<camera3_device_t *>(
+            SamsungCameraDevice::wrap(0, fake.characteristics(), fake.device()));
+
+    Framework framework(&fake);
+    if (run.manageBuffers) {
+        framework.manageBuffers();
+    }
+    device->ops->initialize(device, &framework);
+
+    std::vector<camera3_stream_t *> streams;
+    for (camera3_stream_t& stream : run.streams) {
+        streams.push_back(&stream);
+    }
+
+    camera3_stream_configuration_t streamList;
+    memset(&streamList, 0, sizeof(streamList));
+    streamList.num_streams = streams.size();
+    streamList.streams = streams.data();
+    streamList.operation_mode = run.operationMode;
+    device->ops->configure_streams(device, &streamList);
+
+    // Empty with -B, the device asks for them.
+    static native_handle_t buffer;
+    static buffer_handle_t handle = &buffer, emptyHandle = nullptr;
+    std::vector<camera3_stream_buffer_t> outputBuffers;
+    for (camera3_stream_t *stream : streams) {
+        outputBuffers.push_back({stream, run.manageBuffers ? &emptyHandle : &handle,
+                                 CAMERA3_BUFFER_STATUS_OK, -1, -1});
+    }
+
+    camera_metadata_t *settings = allocate_camera_metadata(0, 0);
+    std::vector<nsecs_t> requestNs;
+    nsecs_t intervalNs = s2ns(1) / fps;
+    nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    for (uint32_t frameNumber = 0; frameNumber < run.numFrames; frameNumber++) {
+        nsecs_t dueNs = startNs + intervalNs * frameNumber;
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (dueNs > now) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(dueNs - now));
+        }
+
+        // Like the framework, block while the HAL has its pipeline full.
+        framework.waitForPending(run.maxInflight - 1, s2ns(5));
+
+        camera3_capture_request_t request;
+        memset(&request, 0, sizeof(request));
+        request.frame_number = frameNumber;
+        request.settings = frameNumber == 0 ? settings : nullptr;
+        request.num_output_buffers = outputBuffers.size();
+        request.output_buffers = outputBuffers.data();
+
+        nsecs_t callNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        framework.requested(frameNumber, callNs);
+        device->ops->process_capture_request(device, &request);
+        requestNs.push_back(callNs);
+    }
+
+    if (run.flush) {
+        nsecs_t flushStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        device->ops->flush(device);
+        nsecs_t flushNs = systemTime(SYSTEM_TIME_MONOTONIC) - flushStartNs;
+
+        std::lock_guard<std::mutex> lock(framework.lock);
+        printf("  Flush returned after %.1fms, %zu frames still pending\n", flushNs / 1e6,
+               framework.pending.size());
+    }
+
+    if (!framework.waitForPending(0, s2ns(5))) {
+        fprintf(stderr, "Timed out, %zu frames still pending\n", framework.pending.size());
+    }
+
+    nsecs_t elapsedNs = systemTime(SYSTEM_TIME_MONOTONIC) - startNs;
+    printf("%u fps: %u requests in %.1fms, %.1f req/s, %zu callbacks, %zu errors\n", fps,
+           run.numFrames, elapsedNs / 1e6, run.numFrames / (elapsedNs / 1e9),
+           framework.numDelivered, framework.numErrors);
+
+    std::vector<nsecs_t> requestOverheadNs;
+    for (size_t i = 0; i < requestNs.size() && i < fake.requestEntryNs.size(); i++) {
+        requestOverheadNs.push_back(fake.requestEntryNs[i] - requestNs[i]);
+    }
+    if (run.manageBuffers) {
+        printf("  At most %u buffers of a stream handed out\n", framework.maxBuffersOut);
+    }
+    printStats("  Result latency", framework.resultLatencyNs);
+    printStats("  Request path overhead", requestOverheadNs);
+    {
+        std::lock_guard<std::mutex> lock(framework.lock);
+        printStats("  Callback path overhead", framework.callbackNs);
+    }
+
+    fflush(stdout);
+    if (run.dump) {
+        device->ops->dump(device, STDOUT_FILENO);
+    }
+    fake.stop();
+    device->common.close(&device->common);
+    nsecs_t closeWaitNs = fake.waitForClose();
+    if (closeWaitNs >= ms2ns(1)) {
+        printf("  Vendor device closed %.1fms after close returned\n", closeWaitNs / 1e6);
+    }
+    free_camera_metadata(settings);
+}
+
+/*
+ * Parse "WxH:format,..." into output streams.
+ */
+static bool parseStreams(const char *arg, std::vector<camera3_stream_t> *streams) {
+    std::string list(arg);
+    size_t start = 0;
+
+    streams->clear();
+    while (start <= list.size()) {
+        size_t end = std::min(list.find(',', start), list.size());
+        camera3_stream_t stream;
+        int format;
+
+        memset(&stream, 0, sizeof(stream));
+        if (sscanf(list.substr(start, end - start).c_str(), "%ux%u:%d", &stream.width,
+                   &stream.height, &format) != 3) {
+            return false;
+        }
+
+        stream.stream_type = CAMERA3_STREAM_OUTPUT;
+        stream.format = format;
+        stream.max_buffers = 8;
+        streams->push_back(stream);
+        start = end + 1;
+    }
+
+    return !streams->empty();
+}
+
+static std::vector<uint32_t> parseList(const char *arg) {
+    std::vector<uint32_t> values;
+    char *end;
+
+    for (const char *p = arg; *p != '\0'; p = *end == ',' ? end + 1 : end) {
+        values.push_back(strtoul(p, &end, 10));
+        if (end == p) {
+            return {};
+        }
+    }
+
+    return values;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [-b] [-P key=value]... [-d] [-s speed] capture.trace\n"
+            "       %s [-b] [-P key=value]... [-d] -f fps,... [-B] [-H] [-F flush ms]\n"
+            "          [-n frames] [-i max inflight] [-S WxH:format,...] [-p partial results]\n"
+            "          [-l shutter,partial,buffer ms] [-e request,result,buffer errors per mille]\n",
+            name, name);
+}
+
+int main(int argc, char **argv) {
+    SyntheticRun run;
+    std::vector<uint32_t> rates, values;
+    std::vector<std::pair<std::string, std::string>> properties;
+    double speed = 1.0;
+    bool bare = false;
+    bool ok = true;
+    int opt;
+
+    parseStreams("1920x1080:34", &run.streams);
+
+    while ((opt = getopt(argc, argv, "bBde:f:F:Hi:l:n:p:P:s:S:")) != -1) {
+        switch (opt) {
+            case 'b':
+                bare = true;
+                break;
+            case 'B':
+                run.manageBuffers = true;
+                break;
+            case 'd':
+                run.dump = true;
+                break;
+            case 'e':
+                values = parseList(optarg);
+                ok &= values.size() == 3;
+                if (values.size() == 3) {
+                    run.config.errorRequestPerMille = values[0];
+                    run.config.errorResultPerMille = values[1];
+                    run.config.errorBufferPerMille = values[2];
+                }
+                break;
+            case 'f':
+                rates = parseList(optarg);
+                ok &= !rates.empty() &&
+                      std::find(rates.begin(), rates.end(), 0) == rates.end();
+                break;
+            case 'F':
+                run.flush = true;
+                run.config.flushNs = ms2ns(atoi(optarg));
+                break;
+            case 'H':
+                run.operationMode = CAMERA3_STREAM_CONFIGURATION_CONSTRAINED_HIGH_SPEED_MODE;
+                break;
+            case 'i':
+                run.maxInflight = atoi(optarg);
+                ok &= run.maxInflight > 0;
+                break;
+            case 'l':
+                values = parseList(optarg);
+                ok &= values.size() == 3;
+                if (values.size() == 3) {
+                    run.config.shutterNs = ms2ns(values[0]);
+                    run.config.partialResultNs = ms2ns(values[1]);
+                    run.config.bufferNs = ms2ns(values[2]);
+                }
+                break;
+            case 'n':
+                run.numFrames = atoi(optarg);
+                break;
+            case 'p':
+                run.config.partialResultCount = atoi(optarg);
+                break;
+            case 'P':
+                if (const char *value = strchr(optarg, '=')) {
+                    properties.emplace_back(std::string(optarg, value - optarg), value + 1);
+                } else {
+                    ok = false;
+                }
+                break;
+            case 's':
+                speed = atof(optarg);
+                ok &= speed > 0;
+                break;
+            case 'S':
+                ok &= parseStreams(optarg, &run.streams);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+    }
+
+    if (!ok || (rates.empty() ? optind != argc - 1 : optind != argc)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!bare) {
+        setPerFrameFeatureProperties();
+    }
+    if (run.manageBuffers) {
+        setFakeProperty("ro.vendor.camera.provider.hal_buffer_management", "1");
+    }
+    for (const auto& [key, value] : properties) {
+        setFakeProperty(key, value);
+    }
+
+    if (rates.empty()) {
+        return replayTrace(argv[optind], speed, run.dump);
+    }
+
+    for (uint32_t fps : rates) {
+        runSynthetic(run, fps);
+    }
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FakeDevice.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <system/camera_metadata.h>
+
+FakeDevice::FakeDevice(const FakeDeviceConfig& config)
+    : mConfig(config),
+      mCharacteristics(allocate_camera_metadata(1, sizeof(int32_t))),
+      mMetadata(allocate_camera_metadata(0, 0)),
+      mRandom(1) {
+    mConfig.partialResultCount = std::max<uint32_t>(mConfig.partialResultCount, 1);
+
+    int32_t partialResultCount = mConfig.partialResultCount;
+    add_camera_metadata_entry(mCharacteristics, ANDROID_REQUEST_PARTIAL_RESULT_COUNT,
+                              &partialResultCount, 1);
+}
+
+FakeDevice::~FakeDevice() {
+    stop();
+    free_camera_metadata(mCharacteristics);
+    free_camera_metadata(mMetadata);
+}
+
+int FakeDevice::onFlush() {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(mConfig.flushNs));
+
+    return 0;
+}
+
+bool FakeDevice::inject(uint32_t perMille) {
+    return perMille > 0 && mRandom() % 1000 < perMille;
+}
+
+void FakeDevice::onRequest(const camera3_capture_request_t *request, nsecs_t now) {
+    uint32_t frameNumber = request->frame_number;
+    std::vector<camera3_stream_buffer_t> buffers(request->output_buffers,
+                                                 request->output_buffers +
+                                                         request->num_output_buffers);
+
+    if (inject(mConfig.errorRequestPerMille)) {
+        for (camera3_stream_buffer_t& buffer : buffers) {
+            buffer.status = CAMERA3_BUFFER_STATUS_ERROR;
+            buffer.release_fence = buffer.acquire_fence;
+        }
+
+        post(now + mConfig.shutterNs, [=] {
+            sendNotify(CAMERA3_MSG_ERROR, frameNumber, CAMERA3_MSG_ERROR_REQUEST, nullptr, 0);
+            sendResult(frameNumber, 0, buffers);
+        });
+        return;
+    }
+
+    post(now + mConfig.shutterNs,
+         [=] { sendNotify(CAMERA3_MSG_SHUTTER, frameNumber, 0, nullptr, now); });
+
+    bool resultError = inject(mConfig.errorResultPerMille);
+    for (uint32_t partial = 1; partial <= mConfig.partialResultCount && !resultError;
+         partial++) {
+        post(now + mConfig.partialResultNs * partial,
+             [=] { sendResult(frameNumber, partial, {}); });
+    }
+
+    for (camera3_stream_buffer_t& buffer : buffers) {
+        if (inject(mConfig.errorBufferPerMille)) {
+            buffer.status = CAMERA3_BUFFER_STATUS_ERROR;
+            post(now + mConfig.bufferNs, [=] {
+                sendNotify(CAMERA3_MSG_ERROR, frameNumber, CAMERA3_MSG_ERROR_BUFFER,
+                           buffer.stream, 0);
+            });
+        }
+    }
+
+    post(now + mConfig.bufferNs, [=] {
+        if (resultError) {
+            sendNotify(CAMERA3_MSG_ERROR, frameNumber, CAMERA3_MSG_ERROR_RESULT, nullptr, 0);
+        }
+        sendResult(frameNumber, 0, buffers);
+    });
+}
+
+void FakeDevice::sendNotify(int32_t type, uint32_t frameNumber, int32_t errorCode,
+                            camera3_stream_t *errorStream, nsecs_t timestamp) {
+    camera3_notify_msg_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = type;
+    if (type == CAMERA3_MSG_SHUTTER) {
+        msg.message.shutter.frame_number = frameNumber;
+        msg.message.shutter.timestamp = timestamp;
+    } else {
+        msg.message.error.frame_number = frameNumber;
+        msg.message.error.error_stream = errorStream;
+        msg.message.error.error_code = errorCode;
+    }
+
+    notify(&msg);
+}
+
+void FakeDevice::sendResult(uint32_t frameNumber, uint32_t partialResult,
+                            const std::vector<camera3_stream_buffer_t>& buffers) {
+    camera3_capture_result_t captureResult;
+
+    memset(&captureResult, 0, sizeof(captureResult));
+    captureResult.frame_number = frameNumber;
+    captureResult.result = partialResult > 0 ? mMetadata : nullptr;
+    captureResult.num_output_buffers = buffers.size();
+    captureResult.output_buffers = buffers.empty() ? nullptr : buffers.data();
+    captureResult.partial_result = partialResult;
+
+    result(&captureResult);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_DEVICE_H
+#define FAKE_DEVICE_H
+
+#include <random>
+
+#include "StubDevice.h"
+
+struct FakeDeviceConfig {
+    // Delays after the request reaches the device.
+    nsecs_t shutterNs = ms2ns(5);
+    nsecs_t partialResultNs = ms2ns(8);
+    nsecs_t bufferNs = ms2ns(25);
+    // Partial results are sent partialResultNs apart, the last one with the buffers.
+    uint32_t partialResultCount = 1;
+    // How many requests out of 1000 fail with each error.
+    uint32_t errorRequestPerMille = 0;
+    uint32_t errorResultPerMille = 0;
+    uint32_t errorBufferPerMille = 0;
+    // How long flush() takes, requests in flight still complete at their own pace.
+    nsecs_t flushNs = 0;
+};
+
+/*
+ * Answers every request with synthetic notifies and results, following
+ * FakeDeviceConfig, so the provider can be driven at any frame rate with
+ * any mix of errors.
+ */
+class FakeDevice : public StubDevice {
+public:
+    explicit FakeDevice(const FakeDeviceConfig& config);
+    ~FakeDevice();
+
+    /*
+     * Just enough for SamsungCameraDevice to expect the partial results.
+     */
+    const camera_metadata_t *characteristics() const { return mCharacteristics; }
+
+private:
+    void onRequest(const camera3_capture_request_t *request, nsecs_t now) override;
+    int onFlush() override;
+    void sendNotify(int32_t type, uint32_t frameNumber, int32_t errorCode,
+                    camera3_stream_t *errorStream, nsecs_t timestamp);
+    void sendResult(uint32_t frameNumber, uint32_t partialResult,
+                    const std::vector<camera3_stream_buffer_t>& buffers);
+    bool inject(uint32_t perMille);
+
+    FakeDeviceConfig mConfig;
+    camera_metadata_t *mCharacteristics;
+    camera_metadata_t *mMetadata;
+    std::minstd_rand mRandom;
+};
+
+#endif // FAKE_DEVICE_H
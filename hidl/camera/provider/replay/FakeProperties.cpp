@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "FakeProperties.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <mutex>
+
+#include <cutils/properties.h>
+
+const std::map<std::string, std::string> kPerFrameFeatureProperties = {
+    {"ro.vendor.camera.provider.flush_timeout_ms", "500"},
+    {"ro.vendor.camera.provider.frame_trace", "1"},
+    {"ro.vendor.camera.provider.hal_buffer_management", "1"},
+    {"ro.vendor.camera.provider.jpeg_sizes", "1"},
+    {"ro.vendor.camera.provider.latency_stats", "1"},
+    {"ro.vendor.camera.provider.settings_cache", "1"},
+    {"ro.vendor.camera.provider.stats", "1"},
+};
+
+static std::mutex sLock;
+
+// Built on first use, properties may be set from static initializers.
+static std::map<std::string, std::string>& properties() {
+    static std::map<std::string, std::string> *sProperties =
+            new std::map<std::string, std::string>();
+
+    return *sProperties;
+}
+
+void setFakeProperty(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    properties()[key] = value;
+}
+
+void setPerFrameFeatureProperties() {
+    for (const auto& [key, value] : kPerFrameFeatureProperties) {
+        setFakeProperty(key, value);
+    }
+}
+
+extern "C" int property_get(const char *key, char *value, const char *default_value) {
+    std::lock_guard<std::mutex> lock(sLock);
+
+    auto it = properties().find(key);
+    const char *found = it != properties().end() ? it->second.c_str() : default_value;
+    snprintf(value, PROPERTY_VALUE_MAX, "%s", found != nullptr ? found : "");
+    return strlen(value);
+}
+
+extern "C" int8_t property_get_bool(const char *key, int8_t default_value) {
+    char value[PROPERTY_VALUE_MAX];
+
+    property_get(key, value, "");
+    if (!strcmp(value, "1") || !strcmp(value, "y") || !strcmp(value, "yes") ||
+            !strcmp(value, "on") || !strcmp(value, "true")) {
+        return 1;
+    }
+    if (!strcmp(value, "0") || !strcmp(value, "n") || !strcmp(value, "no") ||
+            !strcmp(value, "off") || !strcmp(value, "false")) {
+        return 0;
+    }
+    return default_value;
+}
+
+extern "C" int64_t property_get_int64(const char *key, int64_t default_value) {
+    char value[PROPERTY_VALUE_MAX];
+    char *end;
+
+    property_get(key, value, "");
+    long long result = strtoll(value, &end, 0);
+    return end == value || *end != '\0' ? default_value : result;
+}
+
+extern "C" int32_t property_get_int32(const char *key, int32_t default_value) {
+    int64_t result = property_get_int64(key, default_value);
+
+    return result < INT32_MIN || result > INT32_MAX ? default_value : result;
+}
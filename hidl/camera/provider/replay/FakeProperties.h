@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef FAKE_PROPERTIES_H
+#define FAKE_PROPERTIES_H
+
+#include <string>
+
+/*
+ * property_get() and friends for the host, answering from properties set in
+ * this process instead of libcutils, the way ProbeBenchmark stands in for
+ * hw_get_module(). Features read their property once and keep the answer,
+ * so properties have to be set before the first device is wrapped.
+ */
+void setFakeProperty(const std::string& key, const std::string& value);
+
+/*
+ * Turn on every feature on the request and result paths, so what is
+ * measured is the provider as a device configured with all of them would
+ * run it. Capture traces stay off, they are written to /data.
+ */
+void setPerFrameFeatureProperties();
+
+#endif // FAKE_PROPERTIES_H
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StubDevice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+StubDevice::StubDevice() : callbackStartNs(0), mCallbacks(nullptr), mSeq(0), mStop(false),
+      mClosed(false) {
+    memset(&mOps, 0, sizeof(mOps));
+    mOps.initialize = sInitialize;
+    mOps.configure_streams = sConfigureStreams;
+    mOps.construct_default_request_settings = sConstructDefaultRequestSettings;
+    mOps.process_capture_request = sProcessCaptureRequest;
+    mOps.dump = sDump;
+    mOps.flush = sFlush;
+
+    memset(&mDevice, 0, sizeof(mDevice));
+    mDevice.common.tag = HARDWARE_DEVICE_TAG;
+    mDevice.common.version = CAMERA_DEVICE_API_VERSION_3_5;
+    mDevice.common.close = sClose;
+    mDevice.ops = &mOps;
+    mDevice.priv = this;
+
+    mThread = std::thread(&StubDevice::run, this);
+}
+
+StubDevice::~StubDevice() {
+    stop();
+}
+
+void StubDevice::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStop = true;
+    }
+    mCondition.notify_all();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void StubDevice::post(nsecs_t dueNs, std::function<void()> event) {
+    mQueue.push({dueNs, mSeq++, std::move(event)});
+    mCondition.notify_all();
+}
+
+void StubDevice::notify(const camera3_notify_msg_t *msg) {
+    callbackStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    mCallbacks->notify(mCallbacks, msg);
+}
+
+void StubDevice::result(const camera3_capture_result_t *result) {
+    callbackStartNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    mCallbacks->process_capture_result(mCallbacks, result);
+}
+
+camera3_stream_t *StubDevice::stream(int32_t index) const {
+    return index >= 0 && static_cast<size_t>(index) < mStreams.size() ? mStreams[index] : nullptr;
+}
+
+StubDevice *StubDevice::from(const camera3_device *device) {
+    return static_cast<StubDevice *>(device->priv);
+}
+
+nsecs_t StubDevice::waitForClose() {
+    nsecs_t startNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    std::unique_lock<std::mutex> lock(mLock);
+
+    mCondition.wait(lock, [this] { return mClosed; });
+    return systemTime(SYSTEM_TIME_MONOTONIC) - startNs;
+}
+
+int StubDevice::sClose(hw_device_t *device) {
+    StubDevice *self = from(reinterpret_cast<const camera3_device *>(device));
+
+    {
+        std::lock_guard<std::mutex> lock(self->mLock);
+        self->mClosed = true;
+    }
+    self->mCondition.notify_all();
+
+    return 0;
+}
+
+int StubDevice::sInitialize(const camera3_device *device, const camera3_callback_ops_t *ops) {
+    from(device)->mCallbacks = ops;
+    return 0;
+}
+
+int StubDevice::sConfigureStreams(const camera3_device *device,
+                                  camera3_stream_configuration_t *streamList) {
+    StubDevice *self = from(device);
+    std::lock_guard<std::mutex> lock(self->mLock);
+
+    self->mStreams.assign(streamList->streams, streamList->streams + streamList->num_streams);
+    return 0;
+}
+
+const camera_metadata_t *StubDevice::sConstructDefaultRequestSettings(const camera3_device *,
+                                                                      int) {
+    return nullptr;
+}
+
+int StubDevice::sProcessCaptureRequest(const camera3_device *device,
+                                       camera3_capture_request_t *request) {
+    StubDevice *self = from(device);
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    std::lock_guard<std::mutex> lock(self->mLock);
+
+    self->requestEntryNs.push_back(now);
+    self->onRequest(request, now);
+
+    return 0;
+}
+
+void StubDevice::sDump(const camera3_device *, int fd) {
+    dprintf(fd, "Stub device\n");
+}
+
+int StubDevice::sFlush(const camera3_device *device) {
+    return from(device)->onFlush();
+}
+
+void StubDevice::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    while (!mStop) {
+        if (mQueue.empty()) {
+            mCondition.wait(lock);
+            continue;
+        }
+
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (mQueue.top().dueNs > now) {
+            mCondition.wait_for(lock, std::chrono::nanoseconds(mQueue.top().dueNs - now));
+            continue;
+        }
+
+        Event event = mQueue.top();
+        mQueue.pop();
+        latenessNs.push_back(now - event.dueNs);
+
+        lock.unlock();
+        event.send();
+        lock.lock();
+    }
+}
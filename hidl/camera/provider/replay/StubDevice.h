@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STUB_DEVICE_H
+#define STUB_DEVICE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <hardware/camera3.h>
+#include <utils/Timers.h>
+
+/*
+ * A camera3_device standing in for the vendor HAL on the host.
+ *
+ * Subclasses decide what each request gets back and when, by posting
+ * events from onRequest(). A single thread sends them out in order of
+ * their due time, like the callback thread of a real HAL.
+ */
+class StubDevice {
+public:
+    StubDevice();
+    virtual ~StubDevice();
+
+    hw_device_t *device() { return &mDevice.common; }
+
+    /*
+     * Stop sending events, must be called before the subclass goes away.
+     */
+    void stop();
+
+    /*
+     * Wait for the device to be closed, which a close during a late flush
+     * leaves to the flush thread. Returns for how long it waited.
+     */
+    nsecs_t waitForClose();
+
+    // When each request reached the stub.
+    std::vector<nsecs_t> requestEntryNs;
+    // How late each event was sent compared to its due time.
+    std::vector<nsecs_t> latenessNs;
+    // When the callback currently being sent left the stub.
+    std::atomic<nsecs_t> callbackStartNs;
+
+protected:
+    /*
+     * Called with the lock held, on the thread calling process_capture_request.
+     */
+    virtual void onRequest(const camera3_capture_request_t *request, nsecs_t now) = 0;
+
+    /*
+     * Called without the lock, events keep being sent meanwhile.
+     */
+    virtual int onFlush() { return 0; }
+
+    void post(nsecs_t dueNs, std::function<void()> event);
+    void notify(const camera3_notify_msg_t *msg);
+    void result(const camera3_capture_result_t *result);
+    camera3_stream_t *stream(int32_t index) const;
+
+    std::vector<camera3_stream_t *> mStreams;
+
+private:
+    struct Event {
+        nsecs_t dueNs;
+        uint64_t seq;
+        std::function<void()> send;
+
+        bool operator>(const Event& other) const {
+            return dueNs != other.dueNs ? dueNs > other.dueNs : seq > other.seq;
+        }
+    };
+
+    static StubDevice *from(const camera3_device *device);
+    static int sClose(hw_device_t *device);
+    static int sInitialize(const camera3_device *device, const camera3_callback_ops_t *ops);
+    static int sConfigureStreams(const camera3_device *device,
+                                 camera3_stream_configuration_t *streamList);
+    static const camera_metadata_t *sConstructDefaultRequestSettings(const camera3_device *device,
+                                                                     int type);
+    static int sProcessCaptureRequest(const camera3_device *device,
+                                      camera3_capture_request_t *request);
+    static void sDump(const camera3_device *device, int fd);
+    static int sFlush(const camera3_device *device);
+
+    void run();
+
+    camera3_device_t mDevice;
+    camera3_device_ops_t mOps;
+    const camera3_callback_ops_t *mCallbacks;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> mQueue;
+    uint64_t mSeq;
+    bool mStop;
+    bool mClosed;
+    std::thread mThread;
+};
+
+#endif // STUB_DEVICE_H
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TraceDevice.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+const camera_metadata_t *traceMetadata(const void *data, uint32_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    auto *metadata = static_cast<const camera_metadata_t *>(data);
+    size_t expectedSize = size;
+    return validate_camera_metadata_structure(metadata, &expectedSize) == 0 ? metadata : nullptr;
+}
+
+bool loadTrace(const char *path, Trace *trace) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+
+    size_t size = st.st_size;
+    void *map = size >= sizeof(CaptureTraceHeader) ?
+            mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %s\n", path);
+        return false;
+    }
+
+    auto *data = static_cast<const uint8_t *>(map);
+    trace->header = static_cast<const CaptureTraceHeader *>(map);
+    trace->characteristics = nullptr;
+    if (trace->header->magic != kCaptureTraceMagic ||
+            trace->header->version != kCaptureTraceVersion) {
+        fprintf(stderr, "%s is not a capture trace\n", path);
+        return false;
+    }
+
+    size_t offset = sizeof(CaptureTraceHeader);
+    while (offset + sizeof(CaptureTraceRecord) <= size) {
+        auto *record = reinterpret_cast<const CaptureTraceRecord *>(data + offset);
+
+        if (record->type == CAPTURE_RECORD_NONE ||
+                record->size > size - offset - sizeof(CaptureTraceRecord)) {
+            break;
+        }
+
+        if (record->type == CAPTURE_RECORD_CHARACTERISTICS) {
+            auto *characteristics = tracePayload<CaptureTraceMetadata>(record);
+            trace->characteristics = traceMetadata(characteristics + 1,
+                                                   characteristics->metadataSize);
+        } else {
+            trace->records.push_back(record);
+        }
+
+        offset += sizeof(CaptureTraceRecord) + record->size;
+    }
+
+    return true;
+}
+
+TraceDevice::TraceDevice(const Trace& trace, double speed) : mSpeed(speed) {
+    for (const CaptureTraceRecord *record : trace.records) {
+        if (record->type == CAPTURE_RECORD_REQUEST) {
+            mRequestTimes[tracePayload<CaptureTraceRequest>(record)->frameNumber] =
+                    record->timestampNs;
+        } else if (record->type == CAPTURE_RECORD_NOTIFY) {
+            mFrameEvents[tracePayload<CaptureTraceNotify>(record)->frameNumber].push_back(record);
+        } else if (record->type == CAPTURE_RECORD_RESULT) {
+            mFrameEvents[tracePayload<CaptureTraceResult>(record)->frameNumber].push_back(record);
+        }
+    }
+}
+
+TraceDevice::~TraceDevice() {
+    stop();
+}
+
+void TraceDevice::onRequest(const camera3_capture_request_t *request, nsecs_t now) {
+    auto requestTime = mRequestTimes.find(request->frame_number);
+    auto events = mFrameEvents.find(request->frame_number);
+    if (requestTime == mRequestTimes.end() || events == mFrameEvents.end()) {
+        return;
+    }
+
+    for (const CaptureTraceRecord *record : events->second) {
+        nsecs_t delay = (record->timestampNs - requestTime->second) / mSpeed;
+        post(now + std::max<nsecs_t>(delay, 0), [this, record] { send(record); });
+    }
+}
+
+void TraceDevice::buffers(const CaptureTraceBuffer *records, uint32_t num,
+                          std::vector<camera3_stream_buffer_t> *buffers) {
+    static buffer_handle_t handle = nullptr;
+
+    for (uint32_t i = 0; i < num; i++) {
+        buffers->push_back({
+            .stream = stream(records[i].stream),
+            .buffer = &handle,
+            .status = records[i].status,
+            .acquire_fence = -1,
+            .release_fence = -1,
+        });
+    }
+}
+
+void TraceDevice::send(const CaptureTraceRecord *record) {
+    if (record->type == CAPTURE_RECORD_NOTIFY) {
+        const CaptureTraceNotify *recorded = tracePayload<CaptureTraceNotify>(record);
+        camera3_notify_msg_t msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.type = recorded->type;
+        if (recorded->type == CAMERA3_MSG_SHUTTER) {
+            msg.message.shutter.frame_number = recorded->frameNumber;
+            msg.message.shutter.timestamp = recorded->timestamp;
+        } else {
+            msg.message.error.frame_number = recorded->frameNumber;
+            msg.message.error.error_stream = stream(recorded->errorStream);
+            msg.message.error.error_code = recorded->errorCode;
+        }
+
+        notify(&msg);
+        return;
+    }
+
+    const CaptureTraceResult *recorded = tracePayload<CaptureTraceResult>(record);
+    auto *bufferRecords = reinterpret_cast<const CaptureTraceBuffer *>(recorded + 1);
+    std::vector<camera3_stream_buffer_t> outputBuffers, inputBuffer;
+
+    buffers(bufferRecords, recorded->numOutputBuffers, &outputBuffers);
+    if (recorded->inputStream >= 0) {
+        CaptureTraceBuffer input = {recorded->inputStream, CAMERA3_BUFFER_STATUS_OK};
+        buffers(&input, 1, &inputBuffer);
+    }
+
+    camera3_capture_result_t captureResult;
+    memset(&captureResult, 0, sizeof(captureResult));
+    captureResult.frame_number = recorded->frameNumber;
+    captureResult.result = traceMetadata(bufferRecords + recorded->numOutputBuffers,
+                                         recorded->metadataSize);
+    captureResult.num_output_buffers = outputBuffers.size();
+    captureResult.output_buffers = outputBuffers.data();
+    captureResult.input_buffer = inputBuffer.empty() ? nullptr : inputBuffer.data();
+    captureResult.partial_result = recorded->partialResult;
+
+    result(&captureResult);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRACE_DEVICE_H
+#define TRACE_DEVICE_H
+
+#include <map>
+#include <vector>
+
+#include "CaptureTrace.h"
+#include "StubDevice.h"
+
+struct Trace {
+    const CaptureTraceHeader *header;
+    const camera_metadata_t *characteristics;
+    std::vector<const CaptureTraceRecord *> records;
+};
+
+bool loadTrace(const char *path, Trace *trace);
+
+template <typename T>
+static inline const T *tracePayload(const CaptureTraceRecord *record) {
+    return reinterpret_cast<const T *>(record + 1);
+}
+
+/*
+ * NULL for an empty or damaged metadata copy.
+ */
+const camera_metadata_t *traceMetadata(const void *data, uint32_t size);
+
+/*
+ * Answers every request with what was recorded for its frame number,
+ * after the recorded delay divided by speed.
+ */
+class TraceDevice : public StubDevice {
+public:
+    TraceDevice(const Trace& trace, double speed);
+    ~TraceDevice();
+
+private:
+    void onRequest(const camera3_capture_request_t *request, nsecs_t now) override;
+    void send(const CaptureTraceRecord *record);
+    void buffers(const CaptureTraceBuffer *records, uint32_t num,
+                 std::vector<camera3_stream_buffer_t> *buffers);
+
+    double mSpeed;
+    std::map<uint32_t, nsecs_t> mRequestTimes;
+    std::map<uint32_t, std::vector<const CaptureTraceRecord *>> mFrameEvents;
+};
+
+#endif // TRACE_DEVICE_H
@@ -19,15 +19,53 @@
 
 #include <android/hardware/camera/provider/2.5/ICameraProvider.h>
 #include <binder/ProcessState.h>
+#include <cutils/properties.h>
 #include <hidl/HidlLazyUtils.h>
 #include <hidl/HidlTransportSupport.h>
 
-#include "CameraProvider_2_5.h"
+#include <chrono>
+#include <thread>
+
+#include "SamsungCameraModule.h"
 #include "SamsungCameraProvider.h"
 
 using android::status_t;
 using android::hardware::camera::provider::V2_5::ICameraProvider;
 
+#ifdef LAZY_SERVICE
+using android::hardware::LazyServiceRegistrar;
+
+// How long the provider lingers once its last client is gone.
+const char *kLazyIdleTimeoutProp = "ro.vendor.camera.provider.lazy_idle_timeout_ms";
+const int kLazyIdleTimeoutMsDefault = 30000;
+
+/*
+ * Runs on a binder thread when the provider gains its first client or
+ * loses its last one, the registrar leaves the exit to us.
+ *
+ * onClients() is oneway, so a client showing up while lingering is only
+ * reported once this returns, and makes tryUnregister() fail meanwhile.
+ */
+static bool onActiveServicesChanged(int idleTimeoutMs, bool hasClients) {
+    if (hasClients) {
+        return true;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(idleTimeoutMs));
+
+    auto& registrar = LazyServiceRegistrar::getInstance();
+    if (!registrar.tryUnregister()) {
+        ALOGI("Provider got a client while going idle, staying up");
+        return true;
+    }
+
+    // Unregistered without clients, nothing can be in a call into us anymore.
+    ALOGI("Provider idle for %d ms, exiting", idleTimeoutMs);
+    SamsungCameraModule::persist();
+    exit(0);
+}
+#endif
+
 int main()
 {
     using namespace android::hardware::camera::provider::V2_5::implementation;
@@ -36,11 +74,31 @@ int main()
 
     ::android::hardware::configureRpcThreadpool(/*threads*/ HWBINDER_THREAD_COUNT, /*willJoin*/ true);
 
-    ::android::sp<ICameraProvider> provider = new CameraProvider<SamsungCameraProvider>();
+    // Before the provider probes the module, so it can be served from disk.
+    SamsungCameraModule::hook();
+
+    ::android::sp<ICameraProvider> provider = new SamsungCameraProviderService();
 
+#ifdef LAZY_SERVICE
+    int idleTimeoutMs = property_get_int32(kLazyIdleTimeoutProp, kLazyIdleTimeoutMsDefault);
+
+    status_t status = LazyServiceRegistrar::getInstance().registerService(provider, "legacy/0");
+    LOG_ALWAYS_FATAL_IF(status != android::OK, "Error while registering lazy provider service: %d",
+            status);
+
+    // Take over the exit, the default one happens as soon as the last client leaves.
+    LazyServiceRegistrar::getInstance().setActiveServicesCallback(
+            [idleTimeoutMs](bool hasClients) {
+                return onActiveServicesChanged(idleTimeoutMs, hasClients);
+            });
+#else
     status_t status = provider->registerAsService("legacy/0");
     LOG_ALWAYS_FATAL_IF(status != android::OK, "Error while registering provider service: %d",
             status);
+#endif
+
+    // Off the startup path, once everything has been probed.
+    SamsungCameraModule::persist();
 
     ::android::hardware::joinRpcThreadpool();
 
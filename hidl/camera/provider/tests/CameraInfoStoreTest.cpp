@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <system/camera_metadata.h>
+
+#include "CameraInfoStore.h"
+
+using ::android::base::ReadFileToString;
+using ::android::base::WriteStringToFile;
+
+class CameraInfoStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mPath = std::string(mDir.path) + "/camera_info.cache";
+
+        mModule = {};
+        mModule.common.name = "Fake camera module";
+        mModule.common.module_api_version = CAMERA_MODULE_API_VERSION_2_5;
+
+        int32_t maxSize = 12 * 1024 * 1024;
+        mMetadata = allocate_camera_metadata(4, 64);
+        add_camera_metadata_entry(mMetadata, ANDROID_JPEG_MAX_SIZE, &maxSize, 1);
+
+        camera_info back = {};
+        back.facing = CAMERA_FACING_BACK;
+        back.orientation = 90;
+        back.device_version = CAMERA_DEVICE_API_VERSION_3_5;
+        back.static_camera_characteristics = mMetadata;
+        back.resource_cost = 60;
+        back.conflicting_devices = mConflicting;
+        back.conflicting_devices_length = 2;
+        mInfos[0] = back;
+
+        camera_info front = {};
+        front.facing = CAMERA_FACING_FRONT;
+        front.orientation = 270;
+        front.device_version = CAMERA_DEVICE_API_VERSION_3_5;
+        front.resource_cost = 40;
+        mInfos[52] = front;
+    }
+
+    void TearDown() override { free_camera_metadata(mMetadata); }
+
+    bool load(std::map<int, camera_info> *infos) {
+        return CameraInfoStore::load(&mModule, infos, mPath.c_str());
+    }
+
+    TemporaryDir mDir;
+    std::string mPath;
+    camera_module_t mModule;
+    camera_metadata_t *mMetadata;
+    char mDevice1[2] = "1";
+    char mDevice2[3] = "52";
+    char *mConflicting[2] = {mDevice1, mDevice2};
+    std::map<int, camera_info> mInfos;
+};
+
+TEST_F(CameraInfoStoreTest, RoundTrips) {
+    std::map<int, camera_info> loaded;
+
+    ASSERT_TRUE(CameraInfoStore::save(&mModule, mInfos, mPath.c_str()));
+    EXPECT_NE(0, access((mPath + ".tmp").c_str(), F_OK));
+    ASSERT_TRUE(load(&loaded));
+    ASSERT_EQ(2u, loaded.size());
+
+    const camera_info& back = loaded[0];
+    EXPECT_EQ(CAMERA_FACING_BACK, back.facing);
+    EXPECT_EQ(90, back.orientation);
+    EXPECT_EQ(static_cast<uint32_t>(CAMERA_DEVICE_API_VERSION_3_5), back.device_version);
+    EXPECT_EQ(60, back.resource_cost);
+    ASSERT_EQ(2u, back.conflicting_devices_length);
+    EXPECT_STREQ("1", back.conflicting_devices[0]);
+    EXPECT_STREQ("52", back.conflicting_devices[1]);
+    ASSERT_NE(nullptr, back.static_camera_characteristics);
+    size_t size = get_camera_metadata_size(mMetadata);
+    ASSERT_EQ(size, get_camera_metadata_size(back.static_camera_characteristics));
+    EXPECT_EQ(0, memcmp(mMetadata, back.static_camera_characteristics, size));
+
+    const camera_info& front = loaded[52];
+    EXPECT_EQ(CAMERA_FACING_FRONT, front.facing);
+    EXPECT_EQ(40, front.resource_cost);
+    EXPECT_EQ(0u, front.conflicting_devices_length);
+    EXPECT_EQ(nullptr, front.static_camera_characteristics);
+}
+
+TEST_F(CameraInfoStoreTest, Missing) {
+    std::map<int, camera_info> loaded;
+
+    EXPECT_FALSE(load(&loaded));
+    EXPECT_TRUE(loaded.empty());
+}
+
+TEST_F(CameraInfoStoreTest, OtherModule) {
+    std::map<int, camera_info> loaded;
+
+    ASSERT_TRUE(CameraInfoStore::save(&mModule, mInfos, mPath.c_str()));
+    mModule.common.name = "Updated camera module";
+    EXPECT_FALSE(load(&loaded));
+
+    mModule.common.name = "Fake camera module";
+    mModule.common.module_api_version = CAMERA_MODULE_API_VERSION_2_4;
+    EXPECT_FALSE(load(&loaded));
+    EXPECT_TRUE(loaded.empty());
+}
+
+TEST_F(CameraInfoStoreTest, BadMagic) {
+    std::string content;
+    std::map<int, camera_info> loaded;
+
+    ASSERT_TRUE(CameraInfoStore::save(&mModule, mInfos, mPath.c_str()));
+    ASSERT_TRUE(ReadFileToString(mPath, &content));
+    content[0] ^= 0xff;
+    ASSERT_TRUE(WriteStringToFile(content, mPath));
+
+    EXPECT_FALSE(load(&loaded));
+    EXPECT_TRUE(loaded.empty());
+}
+
+/*
+ * However short the file got cut, e.g. by a crash while writing it
+ * elsewhere, it is rejected rather than read past its end.
+ */
+TEST_F(CameraInfoStoreTest, Truncated) {
+    std::string content;
+
+    ASSERT_TRUE(CameraInfoStore::save(&mModule, mInfos, mPath.c_str()));
+    ASSERT_TRUE(ReadFileToString(mPath, &content));
+
+    for (size_t size = 0; size < content.size(); size++) {
+        std::map<int, camera_info> loaded;
+
+        ASSERT_TRUE(WriteStringToFile(content.substr(0, size), mPath));
+        EXPECT_FALSE(load(&loaded)) << size << " of " << content.size() << " bytes";
+        EXPECT_TRUE(loaded.empty());
+    }
+}
+
+/*
+ * Whatever byte gets damaged, loading either fails or yields every ID,
+ * and nothing points outside the file.
+ */
+TEST_F(CameraInfoStoreTest, Corrupted) {
+    std::string content;
+
+    ASSERT_TRUE(CameraInfoStore::save(&mModule, mInfos, mPath.c_str()));
+    ASSERT_TRUE(ReadFileToString(mPath, &content));
+
+    for (size_t offset = 0; offset < content.size(); offset++) {
+        for (uint8_t value : {0x00, 0x7f, 0xff}) {
+            std::string corrupted = content;
+            std::map<int, camera_info> loaded;
+
+            corrupted[offset] = value;
+            ASSERT_TRUE(WriteStringToFile(corrupted, mPath));
+            if (!load(&loaded)) {
+                EXPECT_TRUE(loaded.empty());
+                continue;
+            }
+
+            for (const auto& [id, info] : loaded) {
+                for (size_t n = 0; n < info.conflicting_devices_length; n++) {
+                    EXPECT_LT(strlen(info.conflicting_devices[n]), content.size());
+                }
+                if (info.static_camera_characteristics != nullptr) {
+                    EXPECT_LE(get_camera_metadata_size(info.static_camera_characteristics),
+                              content.size());
+                }
+            }
+        }
+    }
+}
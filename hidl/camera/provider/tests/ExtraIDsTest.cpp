@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ExtraIDs.h"
+
+using Ids = std::vector<int>;
+
+TEST(ExtraIDsTest, Empty) {
+    Ids ids, lazyIds;
+
+    parseExtraIDs("", &ids, &lazyIds);
+    EXPECT_TRUE(ids.empty());
+    EXPECT_TRUE(lazyIds.empty());
+}
+
+TEST(ExtraIDsTest, KeepsOrder) {
+    Ids ids, lazyIds;
+
+    parseExtraIDs("52,51,54", &ids, &lazyIds);
+    EXPECT_EQ((Ids{52, 51, 54}), ids);
+    EXPECT_TRUE(lazyIds.empty());
+}
+
+TEST(ExtraIDsTest, SplitsLazy) {
+    Ids ids, lazyIds;
+
+    parseExtraIDs("52,54:lazy,51,50:lazy", &ids, &lazyIds);
+    EXPECT_EQ((Ids{52, 51}), ids);
+    EXPECT_EQ((Ids{54, 50}), lazyIds);
+}
+
+TEST(ExtraIDsTest, RejectsUnknownSuffix) {
+    Ids ids, lazyIds;
+
+    parseExtraIDs("52:eager,54:lazyy,55:,51", &ids, &lazyIds);
+    EXPECT_EQ((Ids{51}), ids);
+    EXPECT_TRUE(lazyIds.empty());
+}
+
+TEST(ExtraIDsTest, SkipsMalformed) {
+    Ids ids, lazyIds;
+
+    parseExtraIDs("52,,abc,-1,5x,:lazy,99999999999,51", &ids, &lazyIds);
+    EXPECT_EQ((Ids{52, 51}), ids);
+    EXPECT_TRUE(lazyIds.empty());
+}
+
+TEST(ExtraIDsTest, AppendsToExisting) {
+    Ids ids = {20}, lazyIds = {21};
+
+    parseExtraIDs("52,54:lazy", &ids, &lazyIds);
+    EXPECT_EQ((Ids{20, 52}), ids);
+    EXPECT_EQ((Ids{21, 54}), lazyIds);
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <utils/Timers.h>
+
+#include "SamsungCameraDevice.h"
+#include "replay/FakeProperties.h"
+
+// Read once by the first device wrapped, so set before any test runs.
+static const bool sFlushTimeoutSet =
+        (setFakeProperty("ro.vendor.camera.provider.flush_timeout_ms", "50"), true);
+
+/*
+ * A vendor device whose flush() only returns once released, and which can
+ * call back at any time.
+ */
+struct BlockingVendor : public camera3_device_t {
+    camera3_device_ops_t vendorOps;
+    const camera3_callback_ops_t *callbacks = nullptr;
+
+    std::mutex lock;
+    std::condition_variable condition;
+    bool flushing = false;
+    bool released = false;
+    bool closed = false;
+
+    BlockingVendor() {
+        memset(static_cast<camera3_device_t *>(this), 0, sizeof(camera3_device_t));
+        memset(&vendorOps, 0, sizeof(vendorOps));
+        vendorOps.initialize = [](const camera3_device *device,
+                                  const camera3_callback_ops_t *callbacks) {
+            from(device)->callbacks = callbacks;
+            return 0;
+        };
+        vendorOps.flush = sFlush;
+
+        common.version = CAMERA_DEVICE_API_VERSION_3_5;
+        common.close = sClose;
+        ops = &vendorOps;
+    }
+
+    static BlockingVendor *from(const camera3_device *device) {
+        return static_cast<BlockingVendor *>(const_cast<camera3_device *>(device));
+    }
+
+    static int sFlush(const camera3_device *device) {
+        BlockingVendor *self = from(device);
+        std::unique_lock<std::mutex> l(self->lock);
+
+        self->flushing = true;
+        self->condition.notify_all();
+        self->condition.wait(l, [self] { return self->released; });
+        self->flushing = false;
+        return 0;
+    }
+
+    static int sClose(hw_device_t *device) {
+        BlockingVendor *self = from(reinterpret_cast<camera3_device_t *>(device));
+        std::lock_guard<std::mutex> l(self->lock);
+
+        self->closed = true;
+        self->condition.notify_all();
+        return 0;
+    }
+
+    bool isFlushing() {
+        std::lock_guard<std::mutex> l(lock);
+        return flushing;
+    }
+
+    bool isClosed() {
+        std::lock_guard<std::mutex> l(lock);
+        return closed;
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> l(lock);
+        released = true;
+        condition.notify_all();
+    }
+
+    bool waitForClose() {
+        std::unique_lock<std::mutex> l(lock);
+        return condition.wait_for(l, std::chrono::seconds(5), [this] { return closed; });
+    }
+
+    void sendShutter(uint32_t frameNumber) {
+        camera3_notify_msg_t msg = {};
+        msg.type = CAMERA3_MSG_SHUTTER;
+        msg.message.shutter.frame_number = frameNumber;
+        callbacks->notify(callbacks, &msg);
+    }
+
+    void sendDeviceError() {
+        camera3_notify_msg_t msg = {};
+        msg.type = CAMERA3_MSG_ERROR;
+        msg.message.error.error_code = CAMERA3_MSG_ERROR_DEVICE;
+        callbacks->notify(callbacks, &msg);
+    }
+};
+
+struct Framework : public camera3_callback_ops_t {
+    int numNotifies = 0;
+
+    Framework() {
+        memset(static_cast<camera3_callback_ops_t *>(this), 0, sizeof(camera3_callback_ops_t));
+        process_capture_result = [](const camera3_callback_ops_t *,
+                                    const camera3_capture_result_t *) {};
+        notify = [](const camera3_callback_ops_t *ops, const camera3_notify_msg_t *) {
+            static_cast<Framework *>(const_cast<camera3_callback_ops_t *>(ops))->numNotifies++;
+        };
+    }
+};
+
+static camera3_device_t *wrap(BlockingVendor *vendor, Framework *framework) {
+    auto *device = reinterpret_cast<camera3_device_t *>(
+            SamsungCameraDevice::wrap(0, nullptr, &vendor->common));
+    device->ops->initialize(device, framework);
+    return device;
+}
+
+TEST(FlushWatchdogTest, CloseDoesNotWaitForLateFlush) {
+    BlockingVendor vendor;
+    Framework framework;
+    camera3_device_t *device = wrap(&vendor, &framework);
+
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    EXPECT_EQ(0, device->ops->flush(device));
+    EXPECT_TRUE(vendor.isFlushing());
+
+    EXPECT_EQ(0, device->common.close(&device->common));
+    EXPECT_LT(systemTime(SYSTEM_TIME_MONOTONIC) - start, ms2ns(1000));
+    EXPECT_FALSE(vendor.isClosed());
+
+    // Nothing of the blob reaches the framework once closed, not even a dead device.
+    vendor.sendShutter(0);
+    vendor.sendDeviceError();
+    EXPECT_EQ(0, framework.numNotifies);
+
+    vendor.release();
+    EXPECT_TRUE(vendor.waitForClose());
+}
+
+TEST(FlushWatchdogTest, CloseAfterFlushReturned) {
+    BlockingVendor vendor;
+    Framework framework;
+    camera3_device_t *device = wrap(&vendor, &framework);
+
+    vendor.release();
+    EXPECT_EQ(0, device->ops->flush(device));
+
+    EXPECT_EQ(0, device->common.close(&device->common));
+    EXPECT_TRUE(vendor.isClosed());
+}
+
+TEST(FlushWatchdogTest, LateFlushHoldsBackRequests) {
+    BlockingVendor vendor;
+    Framework framework;
+    camera3_device_t *device = wrap(&vendor, &framework);
+
+    EXPECT_EQ(0, device->ops->flush(device));
+
+    // Released only after a while, configure_streams() must not get to the vendor before.
+    std::thread releaser([&vendor] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        vendor.release();
+    });
+    vendor.vendorOps.configure_streams = [](const camera3_device *device,
+                                            camera3_stream_configuration_t *) {
+        return BlockingVendor::from(device)->isFlushing() ? -EBUSY : 0;
+    };
+    camera3_stream_configuration_t streamList = {};
+    EXPECT_EQ(0, device->ops->configure_streams(device, &streamList));
+    releaser.join();
+
+    device->common.close(&device->common);
+    EXPECT_TRUE(vendor.isClosed());
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "InflightRing.h"
+
+using FrameNumbers = std::vector<uint32_t>;
+
+TEST(InflightRingTest, RoundsDepthUp) {
+    EXPECT_EQ(1u, InflightRing<int>(0).capacity());
+    EXPECT_EQ(1u, InflightRing<int>(1).capacity());
+    EXPECT_EQ(8u, InflightRing<int>(5).capacity());
+    EXPECT_EQ(8u, InflightRing<int>(8).capacity());
+    EXPECT_EQ(16u, InflightRing<int>(9).capacity());
+}
+
+TEST(InflightRingTest, InsertFindErase) {
+    InflightRing<int> ring(4);
+
+    EXPECT_TRUE(ring.empty());
+    EXPECT_EQ(nullptr, ring.find(0));
+
+    *ring.insert(0) = 10;
+    *ring.insert(1) = 11;
+    EXPECT_EQ(2u, ring.size());
+    ASSERT_NE(nullptr, ring.find(0));
+    EXPECT_EQ(10, *ring.find(0));
+    EXPECT_EQ(11, *ring.find(1));
+    // Same slot as 0, but not in flight.
+    EXPECT_EQ(nullptr, ring.find(4));
+
+    // Inserting again hands back the same entry.
+    EXPECT_EQ(ring.find(1), ring.insert(1));
+    EXPECT_EQ(2u, ring.size());
+
+    ring.erase(0);
+    EXPECT_EQ(nullptr, ring.find(0));
+    EXPECT_EQ(1u, ring.size());
+
+    // Erasing what isn't there changes nothing.
+    ring.erase(0);
+    ring.erase(5);
+    EXPECT_EQ(1u, ring.size());
+    EXPECT_EQ(0u, ring.numOverflowed());
+}
+
+TEST(InflightRingTest, ReusesSlots) {
+    InflightRing<std::vector<int>> ring(4);
+
+    std::vector<int> *frame = ring.insert(0);
+    frame->reserve(16);
+    ring.erase(0);
+
+    // The next frame in the slot gets the value as it was left.
+    std::vector<int> *next = ring.insert(4);
+    EXPECT_EQ(frame, next);
+    EXPECT_GE(next->capacity(), 16u);
+}
+
+TEST(InflightRingTest, FinishesOutOfOrder) {
+    InflightRing<int> ring(4);
+
+    for (uint32_t frameNumber = 0; frameNumber < 4; frameNumber++) {
+        *ring.insert(frameNumber) = frameNumber;
+    }
+    ring.erase(2);
+    ring.erase(0);
+
+    EXPECT_EQ((FrameNumbers{1, 3}), ring.frameNumbers());
+
+    // Slots of finished frames are free again, the others still taken.
+    *ring.insert(4) = 4;
+    *ring.insert(6) = 6;
+    EXPECT_EQ(0u, ring.numOverflowed());
+    EXPECT_EQ((FrameNumbers{1, 3, 4, 6}), ring.frameNumbers());
+}
+
+TEST(InflightRingTest, Overflows) {
+    InflightRing<int> ring(4);
+
+    // Twice as many frames in flight as the ring is deep.
+    for (uint32_t frameNumber = 0; frameNumber < 8; frameNumber++) {
+        *ring.insert(frameNumber) = frameNumber;
+    }
+
+    EXPECT_EQ(8u, ring.size());
+    EXPECT_EQ(4u, ring.numOverflowed());
+    for (uint32_t frameNumber = 0; frameNumber < 8; frameNumber++) {
+        ASSERT_NE(nullptr, ring.find(frameNumber));
+        EXPECT_EQ(static_cast<int>(frameNumber), *ring.find(frameNumber));
+    }
+    EXPECT_EQ((FrameNumbers{0, 1, 2, 3, 4, 5, 6, 7}), ring.frameNumbers());
+
+    // Found in the overflow even once the ring slot is free again.
+    ring.erase(1);
+    ASSERT_NE(nullptr, ring.find(5));
+    EXPECT_EQ(5, *ring.find(5));
+
+    ring.erase(5);
+    EXPECT_EQ(nullptr, ring.find(5));
+    EXPECT_EQ(6u, ring.size());
+}
+
+TEST(InflightRingTest, Clear) {
+    InflightRing<int> ring(2);
+
+    for (uint32_t frameNumber = 0; frameNumber < 4; frameNumber++) {
+        ring.insert(frameNumber);
+    }
+    ring.clear();
+
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(ring.frameNumbers().empty());
+    for (uint32_t frameNumber = 0; frameNumber < 4; frameNumber++) {
+        EXPECT_EQ(nullptr, ring.find(frameNumber));
+    }
+}
+
+TEST(InflightRingTest, WrapsAround) {
+    InflightRing<int> ring(4);
+
+    *ring.insert(UINT32_MAX - 1) = 1;
+    *ring.insert(UINT32_MAX) = 2;
+    *ring.insert(0) = 3;
+
+    EXPECT_EQ(1, *ring.find(UINT32_MAX - 1));
+    EXPECT_EQ(2, *ring.find(UINT32_MAX));
+    EXPECT_EQ(3, *ring.find(0));
+    EXPECT_EQ(0u, ring.numOverflowed());
+}
+
+/*
+ * Frames finishing in random order, with up to twice the depth in flight,
+ * must look the same as in a map.
+ */
+TEST(InflightRingTest, MatchesMap) {
+    InflightRing<uint32_t> ring(8);
+    std::map<uint32_t, uint32_t> expected;
+    std::minstd_rand random(1);
+    uint32_t nextFrameNumber = 0;
+
+    for (int step = 0; step < 100000; step++) {
+        if (expected.empty() || (expected.size() < 16 && random() % 2 == 0)) {
+            uint32_t frameNumber = nextFrameNumber++;
+            *ring.insert(frameNumber) = frameNumber * 3;
+            expected[frameNumber] = frameNumber * 3;
+        } else {
+            auto it = std::next(expected.begin(), random() % expected.size());
+            ring.erase(it->first);
+            expected.erase(it);
+        }
+
+        ASSERT_EQ(expected.size(), ring.size());
+        uint32_t probe = nextFrameNumber - 1 - random() % 32;
+        uint32_t *value = ring.find(probe);
+        auto it = expected.find(probe);
+        if (it == expected.end()) {
+            ASSERT_EQ(nullptr, value);
+        } else {
+            ASSERT_NE(nullptr, value);
+            ASSERT_EQ(it->second, *value);
+        }
+    }
+
+    FrameNumbers frameNumbers;
+    for (const auto& [frameNumber, value] : expected) {
+        frameNumbers.push_back(frameNumber);
+    }
+    EXPECT_EQ(frameNumbers, ring.frameNumbers());
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <cutils/native_handle.h>
+#include <gtest/gtest.h>
+#include <system/graphics.h>
+
+#include "JpegSizeTracker.h"
+
+/*
+ * A buffer of the given size holding a JPEG of jpegSize bytes, SOI to EOI,
+ * with entropy coded data full of 0xFF in between.
+ */
+static std::vector<uint8_t> makeBuffer(size_t size, uint32_t jpegSize) {
+    std::vector<uint8_t> buffer(size, 0);
+
+    for (uint32_t i = 2; i < jpegSize - 2; i++) {
+        buffer[i] = i % 3 == 0 ? 0xFF : 0x00;
+    }
+    buffer[0] = 0xFF;
+    buffer[1] = 0xD8;
+    buffer[jpegSize - 2] = 0xFF;
+    buffer[jpegSize - 1] = 0xD9;
+
+    return buffer;
+}
+
+static void putHeader(std::vector<uint8_t> *buffer, size_t offset, uint32_t jpegSize) {
+    camera3_jpeg_blob_t blob = {};
+
+    blob.jpeg_blob_id = CAMERA3_JPEG_BLOB_ID;
+    blob.jpeg_size = jpegSize;
+    memcpy(buffer->data() + offset, &blob, sizeof(blob));
+}
+
+TEST(JpegSizeTrackerTest, HeaderAtEnd) {
+    std::vector<uint8_t> buffer = makeBuffer(4096, 1000);
+    putHeader(&buffer, buffer.size() - sizeof(camera3_jpeg_blob_t), 1000);
+
+    uint32_t jpegSize = 0;
+    EXPECT_EQ(JpegSizeTracker::AT_END,
+              JpegSizeTracker::findHeader(buffer.data(), buffer.size(), &jpegSize));
+    EXPECT_EQ(1000u, jpegSize);
+}
+
+TEST(JpegSizeTrackerTest, HeaderMoved) {
+    // Placed for the buffer size asked for, gralloc rounded it up.
+    std::vector<uint8_t> buffer = makeBuffer(8192, 1000);
+    putHeader(&buffer, 4096 - sizeof(camera3_jpeg_blob_t), 1000);
+    // Leftovers between the header and the end don't get in the way.
+    memset(buffer.data() + 6000, 0xFF, 100);
+
+    uint32_t jpegSize = 0;
+    EXPECT_EQ(JpegSizeTracker::MOVED,
+              JpegSizeTracker::findHeader(buffer.data(), buffer.size(), &jpegSize));
+    EXPECT_EQ(1000u, jpegSize);
+}
+
+TEST(JpegSizeTrackerTest, HeaderMovedNeedsWholeJpeg) {
+    std::vector<uint8_t> buffer = makeBuffer(8192, 1000);
+    putHeader(&buffer, 4096 - sizeof(camera3_jpeg_blob_t), 1000);
+    buffer[999] = 0x00;
+
+    uint32_t jpegSize = 0;
+    EXPECT_EQ(JpegSizeTracker::MISSING,
+              JpegSizeTracker::findHeader(buffer.data(), buffer.size(), &jpegSize));
+}
+
+TEST(JpegSizeTrackerTest, HeaderTooFarBack) {
+    std::vector<uint8_t> buffer = makeBuffer(256 * 1024, 1000);
+    putHeader(&buffer, 4096 - sizeof(camera3_jpeg_blob_t), 1000);
+
+    uint32_t jpegSize = 0;
+    EXPECT_EQ(JpegSizeTracker::MISSING,
+              JpegSizeTracker::findHeader(buffer.data(), buffer.size(), &jpegSize));
+}
+
+TEST(JpegSizeTrackerTest, HeaderMissing) {
+    uint32_t jpegSize = 0;
+
+    std::vector<uint8_t> buffer = makeBuffer(4096, 1000);
+    EXPECT_EQ(JpegSizeTracker::MISSING,
+              JpegSizeTracker::findHeader(buffer.data(), buffer.size(), &jpegSize));
+
+    // Larger than what comes before it.
+    putHeader(&buffer, buffer.size() - sizeof(camera3_jpeg_blob_t), 4096);
+    EXPECT_EQ(JpegSizeTracker::MISSING,
+              JpegSizeTracker::findHeader(buffer.data(), buffer.size(), &jpegSize));
+
+    // Too small for a JPEG.
+    putHeader(&buffer, buffer.size() - sizeof(camera3_jpeg_blob_t), 2);
+    EXPECT_EQ(JpegSizeTracker::MISSING,
+              JpegSizeTracker::findHeader(buffer.data(), buffer.size(), &jpegSize));
+
+    // Too small for the header.
+    EXPECT_EQ(JpegSizeTracker::MISSING,
+              JpegSizeTracker::findHeader(buffer.data(), sizeof(camera3_jpeg_blob_t) - 1,
+                                          &jpegSize));
+    EXPECT_EQ(0u, jpegSize);
+}
+
+/*
+ * Hand JPEGs of the given sizes back in 4KiB buffers, and return what
+ * dump() says about them.
+ */
+static std::string track(const std::vector<uint32_t>& jpegSizes) {
+    JpegSizeTracker tracker(0);
+    camera3_stream_t stream = {};
+    camera3_stream_t *streams[] = {&stream};
+    camera3_stream_configuration_t streamList = {};
+
+    stream.stream_type = CAMERA3_STREAM_OUTPUT;
+    stream.width = 64;
+    stream.height = 64;
+    stream.format = HAL_PIXEL_FORMAT_BLOB;
+    stream.data_space = HAL_DATASPACE_V0_JFIF;
+    streamList.num_streams = 1;
+    streamList.streams = streams;
+    tracker.configure(&streamList);
+
+    for (uint32_t frameNumber = 0; frameNumber < jpegSizes.size(); frameNumber++) {
+        std::vector<uint8_t> data = makeBuffer(4096, jpegSizes[frameNumber]);
+        putHeader(&data, data.size() - sizeof(camera3_jpeg_blob_t), jpegSizes[frameNumber]);
+
+        int fd = memfd_create("jpeg", MFD_CLOEXEC);
+        EXPECT_EQ(static_cast<ssize_t>(data.size()), write(fd, data.data(), data.size()));
+        native_handle_t *handle = native_handle_create(1, 0);
+        handle->data[0] = fd;
+        buffer_handle_t bufferHandle = handle;
+
+        camera3_stream_buffer_t buffer = {};
+        buffer.stream = &stream;
+        buffer.buffer = &bufferHandle;
+        buffer.status = CAMERA3_BUFFER_STATUS_OK;
+        buffer.acquire_fence = -1;
+        buffer.release_fence = -1;
+
+        camera3_capture_request_t request = {};
+        request.frame_number = frameNumber;
+        request.num_output_buffers = 1;
+        request.output_buffers = &buffer;
+        tracker.request(&request);
+
+        camera3_capture_result_t result = {};
+        result.frame_number = frameNumber;
+        result.num_output_buffers = 1;
+        result.output_buffers = &buffer;
+        tracker.result(&result);
+
+        native_handle_close(handle);
+        native_handle_delete(handle);
+    }
+
+    FILE *file = tmpfile();
+    std::string text;
+    char buf[4096];
+
+    tracker.dump(fileno(file));
+    rewind(file);
+    while (size_t n = fread(buf, 1, sizeof(buf), file)) {
+        text.append(buf, n);
+    }
+    fclose(file);
+
+    return text;
+}
+
+TEST(JpegSizeTrackerTest, CountsJpegsNearlyFillingTheBuffer) {
+    std::string text = track({1000, 3600, 4000});
+
+    EXPECT_NE(std::string::npos, text.find("3 at the end, 0 moved, 0 missing")) << text;
+    EXPECT_NE(std::string::npos, text.find("JPEGs taking over 90% of their buffer: 2")) << text;
+}
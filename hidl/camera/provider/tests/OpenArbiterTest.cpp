@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "OpenArbiter.h"
+#include "replay/FakeProperties.h"
+
+// Costs are read once, so set before any test runs, for IDs no other test opens.
+static const bool sResourceCostsSet =
+        (setFakeProperty("ro.vendor.camera.provider.resource_costs", "20:60,21:50,22:40"), true);
+
+static std::string dump() {
+    FILE *file = tmpfile();
+    std::string text;
+    char buf[4096];
+
+    OpenArbiter::dump(fileno(file));
+    rewind(file);
+    while (size_t n = fread(buf, 1, sizeof(buf), file)) {
+        text.append(buf, n);
+    }
+    fclose(file);
+
+    return text;
+}
+
+TEST(OpenArbiterTest, RefusesOverBudget) {
+    ASSERT_TRUE(OpenArbiter::isEnabled());
+
+    EXPECT_TRUE(OpenArbiter::acquire(20));
+    EXPECT_FALSE(OpenArbiter::acquire(21));
+    EXPECT_TRUE(OpenArbiter::acquire(22));
+
+    // What a closed camera cost is free again.
+    OpenArbiter::release(20);
+    EXPECT_TRUE(OpenArbiter::acquire(21));
+
+    // IDs without a cost are left alone.
+    EXPECT_TRUE(OpenArbiter::acquire(23));
+
+    OpenArbiter::release(21);
+    OpenArbiter::release(22);
+    OpenArbiter::release(23);
+
+    std::string text = dump();
+    EXPECT_NE(std::string::npos, text.find("ID=21: cost 50, 0 opened, 1 refused")) << text;
+}
+
+TEST(OpenArbiterTest, AdvertisesConflicts) {
+    char vendorConflict[] = "5";
+    char *vendorConflicts[] = {vendorConflict};
+    struct camera_info info = {};
+
+    info.resource_cost = 100;
+    info.conflicting_devices = vendorConflicts;
+    info.conflicting_devices_length = 1;
+    OpenArbiter::advertise(20, &info);
+
+    EXPECT_EQ(60, info.resource_cost);
+    ASSERT_EQ(2u, info.conflicting_devices_length);
+    EXPECT_STREQ("5", info.conflicting_devices[0]);
+    EXPECT_STREQ("21", info.conflicting_devices[1]);
+
+    // Fits next to every other camera.
+    info = {};
+    OpenArbiter::advertise(22, &info);
+    EXPECT_EQ(40, info.resource_cost);
+    EXPECT_EQ(0u, info.conflicting_devices_length);
+
+    info = {};
+    info.resource_cost = 100;
+    OpenArbiter::advertise(23, &info);
+    EXPECT_EQ(100, info.resource_cost);
+}
+
+/*
+ * Opens of different IDs come in on different threads at once, what they
+ * claim together must never go over budget.
+ */
+TEST(OpenArbiterTest, ConcurrentOpensStayWithinBudget) {
+    const int kIds[] = {20, 21, 22};
+    const int kCosts[] = {60, 50, 40};
+    std::atomic<int> openCost(0);
+    std::atomic<int> maxOpenCost(0);
+    std::atomic<int> numOpened(0);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < 3; i++) {
+        threads.emplace_back([&, i] {
+            for (int n = 0; n < 2000; n++) {
+                if (!OpenArbiter::acquire(kIds[i])) {
+                    continue;
+                }
+
+                int cost = openCost += kCosts[i];
+                int max = maxOpenCost.load();
+                while (cost > max && !maxOpenCost.compare_exchange_weak(max, cost)) {
+                }
+                numOpened++;
+
+                openCost -= kCosts[i];
+                OpenArbiter::release(kIds[i]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_GT(numOpened.load(), 0);
+    EXPECT_LE(maxOpenCost.load(), 100);
+}
+
+TEST(OpenArbiterTest, DumpsOpenTimes) {
+    OpenArbiter::opened(24, ms2ns(10));
+    OpenArbiter::opened(24, ms2ns(30));
+    OpenArbiter::initialized(24, ms2ns(5));
+
+    std::string text = dump();
+    EXPECT_NE(std::string::npos, text.find("ID=24: no cost, 2 opened, 0 refused")) << text;
+    EXPECT_NE(std::string::npos, text.find("open: last 30.00ms, avg 20.00ms, max 30.00ms"))
+            << text;
+    EXPECT_NE(std::string::npos, text.find("initialize: last 5.00ms, avg 5.00ms, max 5.00ms"))
+            << text;
+}
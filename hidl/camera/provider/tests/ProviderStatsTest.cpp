@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ProviderStats.h"
+
+// Counters are global, so every test counts for IDs of its own.
+
+static std::string dump() {
+    FILE *file = tmpfile();
+    std::string text;
+    char buf[4096];
+
+    ProviderStats::dump(fileno(file));
+    rewind(file);
+    while (size_t n = fread(buf, 1, sizeof(buf), file)) {
+        text.append(buf, n);
+    }
+    fclose(file);
+
+    return text;
+}
+
+/*
+ * The lines dumped for an ID, up to the next ID.
+ */
+static std::string dumpOf(const std::string& text, const std::string& id) {
+    size_t start = text.find("  ID=" + id + ":");
+    if (start == std::string::npos) {
+        start = text.find("  ID=" + id + " ");
+    }
+    if (start == std::string::npos) {
+        return "";
+    }
+
+    size_t end = text.find("  ID=", start + 1);
+    return text.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+static size_t numThreads(const std::string& text) {
+    size_t n = 0;
+
+    sscanf(text.c_str(), "Samsung camera provider, counted on %zu threads", &n);
+    return n;
+}
+
+TEST(ProviderStatsTest, KeepsCountsOfExitedThreads) {
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([] {
+            for (int n = 0; n < 1000; n++) {
+                ProviderStats::count(1, ProviderStats::REQUEST);
+            }
+            ProviderStats::count(1, ProviderStats::DROPPED_FRAME);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::string id = dumpOf(dump(), "1");
+    EXPECT_NE(std::string::npos, id.find("requests: 8000,")) << id;
+    EXPECT_NE(std::string::npos, id.find(" 8 dropped frames")) << id;
+
+    // Blocks of exited threads are reused, not added.
+    size_t before = numThreads(dump());
+    std::thread([] { ProviderStats::count(1, ProviderStats::REQUEST); }).join();
+    std::string text = dump();
+    EXPECT_EQ(before, numThreads(text));
+    EXPECT_NE(std::string::npos, dumpOf(text, "1").find("requests: 8001,"));
+}
+
+TEST(ProviderStatsTest, Times) {
+    ProviderStats::time(2, ProviderStats::OPEN, ms2ns(10));
+    ProviderStats::time(2, ProviderStats::OPEN, ms2ns(30));
+    ProviderStats::time(2, ProviderStats::CONFIGURE, ms2ns(5));
+
+    std::string id = dumpOf(dump(), "2");
+    EXPECT_NE(std::string::npos, id.find("probe: none, served from the store")) << id;
+    EXPECT_NE(std::string::npos, id.find("open: n=2 avg=20.00ms max=30.00ms")) << id;
+    EXPECT_NE(std::string::npos, id.find("configure_streams: n=1 avg=5.00ms max=5.00ms")) << id;
+}
+
+TEST(ProviderStatsTest, CountsErrors) {
+    camera3_error_msg_t error = {};
+
+    for (int code : {CAMERA3_MSG_ERROR_DEVICE, CAMERA3_MSG_ERROR_REQUEST, CAMERA3_MSG_ERROR_RESULT,
+                     CAMERA3_MSG_ERROR_BUFFER, CAMERA3_MSG_ERROR_BUFFER}) {
+        error.error_code = code;
+        ProviderStats::error(3, &error);
+    }
+
+    std::string id = dumpOf(dump(), "3");
+    EXPECT_NE(std::string::npos, id.find("errors: device 1, request 1, result 1, buffer 2")) << id;
+}
+
+TEST(ProviderStatsTest, ListsExposedIds) {
+    ProviderStats::exposed(5, false);
+    ProviderStats::exposed(52, true);
+    ProviderStats::exposed(100, true);
+    ProviderStats::count(4, ProviderStats::REQUEST);
+    ProviderStats::count(100, ProviderStats::REQUEST);
+    ProviderStats::count(-1, ProviderStats::REQUEST);
+
+    std::string text = dump();
+    EXPECT_NE(std::string::npos, text.find("  ID=5:\n")) << text;
+    EXPECT_NE(std::string::npos, text.find("  ID=52 (extra):\n")) << text;
+    EXPECT_NE(std::string::npos, text.find("  ID=100 (extra): not counted\n")) << text;
+    EXPECT_NE(std::string::npos, text.find("  ID=4 (not exposed):\n")) << text;
+    EXPECT_EQ(std::string::npos, text.find("  ID=-1")) << text;
+
+    // Exposed IDs come first.
+    EXPECT_LT(text.find("  ID=52"), text.find("  ID=4 "));
+}
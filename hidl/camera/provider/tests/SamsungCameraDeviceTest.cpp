@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2023 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include <system/camera_metadata.h>
+#include <system/graphics.h>
+
+#include "SamsungCameraDevice.h"
+
+/*
+ * Only what stream configuration touches, answers reconfiguration queries
+ * by whether the session parameters are different ones.
+ */
+struct VendorDevice : public camera3_device_t {
+    camera3_device_ops_t vendorOps;
+    int numReconfigurationQueries = 0;
+    uint32_t maxBuffers = 4;
+
+    VendorDevice() {
+        memset(static_cast<camera3_device_t *>(this), 0, sizeof(camera3_device_t));
+        memset(&vendorOps, 0, sizeof(vendorOps));
+        vendorOps.initialize = [](const camera3_device *, const camera3_callback_ops_t *) {
+            return 0;
+        };
+        vendorOps.configure_streams = sConfigureStreams;
+        vendorOps.dump = [](const camera3_device *, int) {};
+        vendorOps.is_reconfiguration_required = sIsReconfigurationRequired;
+
+        common.version = CAMERA_DEVICE_API_VERSION_3_5;
+        common.close = [](hw_device_t *) { return 0; };
+        ops = &vendorOps;
+    }
+
+    static VendorDevice *from(const camera3_device *device) {
+        return static_cast<VendorDevice *>(const_cast<camera3_device *>(device));
+    }
+
+    static int sConfigureStreams(const camera3_device *device,
+                                 camera3_stream_configuration_t *streamList) {
+        for (uint32_t i = 0; i < streamList->num_streams; i++) {
+            streamList->streams[i]->max_buffers = from(device)->maxBuffers;
+        }
+        return 0;
+    }
+
+    static int sIsReconfigurationRequired(const camera3_device *device,
+                                          const camera_metadata_t *oldSessionParams,
+                                          const camera_metadata_t *newSessionParams) {
+        from(device)->numReconfigurationQueries++;
+        return oldSessionParams != newSessionParams;
+    }
+};
+
+class SamsungCameraDeviceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        device = reinterpret_cast<camera3_device_t *>(
+                SamsungCameraDevice::wrap(0, nullptr, &vendor.common));
+        ASSERT_NE(&vendor.common, &device->common);
+
+        stream.stream_type = CAMERA3_STREAM_OUTPUT;
+        stream.format = HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED;
+        stream.height = 1080;
+
+        small = allocate_camera_metadata(1, 16);
+        large = allocate_camera_metadata(4, 64);
+    }
+
+    void TearDown() override {
+        device->common.close(&device->common);
+        free_camera_metadata(small);
+        free_camera_metadata(large);
+    }
+
+    void configure(uint32_t width) {
+        camera3_stream_t *streams[] = {&stream};
+        camera3_stream_configuration_t streamList = {};
+
+        stream.width = width;
+        streamList.num_streams = 1;
+        streamList.streams = streams;
+        streamList.operation_mode = CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE;
+        ASSERT_EQ(0, device->ops->configure_streams(device, &streamList));
+    }
+
+    int isReconfigurationRequired(const camera_metadata_t *oldSessionParams,
+                                  const camera_metadata_t *newSessionParams) {
+        return device->ops->is_reconfiguration_required(device, oldSessionParams,
+                                                        newSessionParams);
+    }
+
+    std::string dump() {
+        FILE *file = tmpfile();
+        std::string text;
+        char buf[4096];
+
+        device->ops->dump(device, fileno(file));
+        rewind(file);
+        while (size_t n = fread(buf, 1, sizeof(buf), file)) {
+            text.append(buf, n);
+        }
+        fclose(file);
+
+        return text;
+    }
+
+    VendorDevice vendor;
+    camera3_device_t *device;
+    camera3_stream_t stream = {};
+    camera_metadata_t *small;
+    camera_metadata_t *large;
+};
+
+TEST_F(SamsungCameraDeviceTest, CachesReconfigurationAnswers) {
+    configure(1920);
+
+    EXPECT_EQ(1, isReconfigurationRequired(small, large));
+    EXPECT_EQ(1, isReconfigurationRequired(small, large));
+    EXPECT_EQ(0, isReconfigurationRequired(small, small));
+    EXPECT_EQ(0, isReconfigurationRequired(small, small));
+    EXPECT_EQ(2, vendor.numReconfigurationQueries);
+
+    // The same parameters the other way around are another question.
+    EXPECT_EQ(1, isReconfigurationRequired(large, small));
+    EXPECT_EQ(3, vendor.numReconfigurationQueries);
+
+    EXPECT_NE(std::string::npos, dump().find("Reconfiguration queries: 5, 2 answered from cache"));
+}
+
+TEST_F(SamsungCameraDeviceTest, AsksAgainForAnotherConfiguration) {
+    configure(1920);
+    isReconfigurationRequired(small, large);
+
+    configure(1280);
+    isReconfigurationRequired(small, large);
+    EXPECT_EQ(2, vendor.numReconfigurationQueries);
+
+    // Switching back to the first one, its answers still hold.
+    configure(1920);
+    isReconfigurationRequired(small, large);
+    EXPECT_EQ(2, vendor.numReconfigurationQueries);
+}
+
+TEST_F(SamsungCameraDeviceTest, KeepsConfigurations) {
+    configure(1920);
+    configure(1280);
+    vendor.maxBuffers = 6;
+    configure(1920);
+
+    std::string text = dump();
+    size_t first = text.find("Configuration 0,");
+    size_t second = text.find("Configuration 1,");
+    ASSERT_NE(std::string::npos, first) << text;
+    ASSERT_NE(std::string::npos, second) << text;
+    EXPECT_EQ(std::string::npos, text.find("Configuration 2,")) << text;
+
+    std::string config = text.substr(first, second - first);
+    EXPECT_NE(std::string::npos, config.find("Configured 2 times")) << config;
+    EXPECT_NE(std::string::npos, config.find("max buffers/usage: 6/0x0, changed 1 times"))
+            << config;
+    EXPECT_NE(std::string::npos, text.find("Configured 1 times", second)) << text;
+}